@@ -9,6 +9,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/SourceMgr.h"
@@ -24,7 +25,20 @@
 #include <vector>
 #include <sys/resource.h>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 
+#include "include/BatchAlias.hpp"
+#include "include/InitCache.hpp"
+#include "include/InitGraph.hpp"
+#include "include/GVMetrics.hpp"
+#include "include/Incremental.hpp"
+#include "include/ModuleLoader.hpp"
+#include "include/ResultCache.hpp"
+#include "include/ResultWriter.hpp"
 #include "include/UniasAlgo.hpp"
 #include "include/Util.hpp"
 #include "include/UtilLLVM.hpp"
@@ -50,9 +64,69 @@ const Option<std::string> CallGraphPath("CallGraphPath",
 const Option<std::string> OutputDir("OutputDir",
     "Output Unias results to this dir.", "");
 
+const Option<std::string> ResultOutput("ResultOutput",
+    "Write all GV results to this single JSONL file with a trailing index by GV name, on a background writer thread.", "");
+
+const Option<u32_t> ResultQueue("ResultQueue",
+    "Max number of GV results waiting for the result writer before workers block.", 1024);
+
+const Option<std::string> IncrementalDir("IncrementalDir",
+    "Keep per-GV dependencies and results in this dir, and only re-analyze GVs that depend on bitcode changed since the previous run.", "");
+
+const Option<std::string> ResultCacheDir("ResultCacheDir",
+    "Cache per-GV results in this dir keyed by a fingerprint of the traversed subgraph, and reuse them when the subgraph is unchanged.", "");
+
+const Option<u32_t> PrefetchThreads("PrefetchThreads",
+    "Prefetch input bitcode into the page cache on this many threads and drop unreadable files before SVF parses them, 0 disables.", 0);
+
+const Option<bool> PrefetchVerify("PrefetchVerify",
+    "Diagnostic: also parse and verify each module during the prefetch and report per-module parse time. Every module is then parsed twice.", false);
+
 const Option<u32_t> ThreadNum("ThreadNum",
     "Number of concurrent Unias threads.", 1);
 
+const Option<u32_t> TaskBatch("TaskBatch",
+    "Max number of GVs a worker claims from its own queue at once.", 4);
+
+const Option<u32_t> GVTimeBudgetMs("GVTimeBudgetMs",
+    "Stop analyzing a GV after this many milliseconds and output its partial result, 0 means unlimited.", 0);
+
+const Option<u32_t> GVStepBudget("GVStepBudget",
+    "Stop analyzing a GV after entering this many nodes and output its partial result, 0 means unlimited.", 0);
+
+const Option<u32_t> GVRetryScale("GVRetryScale",
+    "After the first pass, re-run truncated GVs with budgets multiplied by this factor, 0 disables the retry pass.", 4);
+
+const Option<u32_t> BatchLanes("BatchLanes",
+    "Analyze GVs in batches of this many (at most 64) with one shared bit-parallel traversal per batch, 0 uses the per-GV engine.", 0);
+
+const Option<std::string> MetricsOutput("MetricsOutput",
+    "Write one hot-path metrics record per GV to this file (CSV if it ends with .csv, JSONL otherwise).", "");
+
+const Option<u32_t> SummaryCacheMB("SummaryCacheMB",
+    "Memory cap (MB) of the cross-GV traversal summary cache, 0 disables it.", 0);
+
+const Option<u32_t> SummaryMinSteps("SummaryMinSteps",
+    "Only cache traversal summaries of subtrees entering at least this many nodes.", 64);
+
+const Option<u32_t> ShortcutCacheMB("ShortcutCacheMB",
+    "Memory cap (MB) of the cross-GV cache of shortcut expansions per (struct, offset, stack shape), approximate, 0 disables it.", 0);
+
+const Option<u32_t> ShortcutMaxSteps("ShortcutMaxSteps",
+    "Give up caching a shortcut expansion that enters more than this many nodes and expand it inline instead.", 1000000);
+
+const Option<bool> StateDedup("StateDedup",
+    "Experimental, may lose aliases: within a GV, skip a (node, analysis stack, state) already explored at the same or a shallower path depth. Its effect on alias sets has not been measured.", false);
+
+const Option<std::string> AllocDenyList("AllocDenyList",
+    "Load substrings of allocator names whose Call/Ret edges are not followed (one per line).", "");
+
+const Option<std::string> InitCacheDir("InitCacheDir",
+    "Cache the tables derived by initialize() in this dir and reuse them when inputs are unchanged.", "");
+
+const Option<u32_t> InitThreads("InitThreads",
+    "Run independent initialize() setup phases concurrently on this many threads.", 1);
+
 const Option<std::string> SpecificGV("SpecificGV",
     "Specify the name of a single GlobalVariable.", "");
 
@@ -60,27 +134,81 @@ const Option<std::string> InputNewInitFuncs("InputNewInitFuncs",
     "Provide \'Init Functions\'.", "");
 
 const Option<u32_t> VerboseLevel("VerboseLevel",
-    "Print information at which verbose level.", 0); // To use.
+    "Print information at which verbose level (1: one metrics line per GV).", 0);
 
 // 
 // Preparation Phase.
 // 
 
 // Unias分析前的初始化。这里面很多操作都值得分析。
-void initialize(SVFIR* pag, SVFModule* svfModule){
+// 设置了InitCacheDir时，先尝试复用磁盘上的派生表（见InitCache.hpp），不命中时完整初始化后再写回。
+void initialize(SVFIR* pag, SVFModule* svfModule, const std::vector<std::string> &moduleNameVec){
     if(CallGraphPath() != ""){
         readCallGraph(CallGraphPath(), svfModule, pag);
         setupCallGraph(pag);
     }
-    getBlackNodes(pag);
-    setupPhiEdges(pag);
-    setupSelectEdges(pag);
-    handleAnonymousStruct(svfModule, pag);
-    collectByteoffset(pag); // Sikpped wierd GepStmts. (Stuck at somewhere. 2024.10.25)
-    setupStores(pag);
-    processCastSites(pag);
-    processCastMap(pag);
+    if(AllocDenyList() != ""){
+        loadAllocDenyList(AllocDenyList());
+    }
+    string cachePath;
+    u64_t cacheKey = 0;
+    if(InitCacheDir() != ""){
+        std::vector<std::string> inputFiles(moduleNameVec);
+        inputFiles.push_back(SVFIRJsonInput());
+        inputFiles.push_back(CallGraphPath());
+        cacheKey = computeInitCacheKey(inputFiles);
+        cachePath = getInitCachePath(InitCacheDir(), cacheKey);
+    }
+    if(cachePath.empty() || !loadInitCache(cachePath, cacheKey, pag)){
+        // SVFIR在第一次访问某类边的集合时会往map里插入，先串行访问一遍，各阶段并发时对SVFIR就只有读。
+        for(auto kind : {PAGEdge::Copy, PAGEdge::Store, PAGEdge::Gep, PAGEdge::Call, PAGEdge::Ret}){
+            pag->getSVFStmtSet(kind);
+        }
+        pag->getPTASVFStmtSet(PAGEdge::Phi);
+        pag->getPTASVFStmtSet(PAGEdge::Select);
+        // 各阶段按原来的串行顺序加入，每个阶段列出读、写的表（见InitGraph.hpp），依赖只列真正读到的表：
+        // setupPhiEdges读blackNodes；setupStructIDs读nodeIDBound和匿名结构体的命名；
+        // collectByteoffset、processCastSites读node2StructID；setupStores读typebasedShortcuts；finalizeGepInfos读shortcuts和castSites。
+        // getBlackNodes、collectByteoffset和setupStores会在节点上插入空的边集合，三者在同一条依赖链上。
+        // 调用链上的SVF/LLVM查询表（SVFIR的语句集合、LLVMModuleSet）只读，不列入。
+        const u32_t initThreads = std::max<u32_t>(1, InitThreads());
+        InitGraph graph;
+        auto black = graph.add("getBlackNodes", [&](){ getBlackNodes(pag); }, {},
+            0, IT_NodeEdges | IT_BlackNodes);
+        graph.add("setupCallAdmissibility", [&](){ setupCallAdmissibility(pag); }, {},
+            0, IT_BlockedCalls);
+        graph.add("setupPhiEdges", [&](){ setupPhiEdges(pag); }, {black},
+            IT_BlackNodes, IT_PhiEdges);
+        graph.add("setupSelectEdges", [&](){ setupSelectEdges(pag); }, {},
+            0, IT_SelectEdges);
+        auto anon = graph.add("handleAnonymousStruct", [&](){ handleAnonymousStruct(svfModule, pag); }, {},
+            0, IT_AnonStructs);
+        auto structIDs = graph.add("setupStructIDs", [&](){ setupStructIDs(pag); }, {black, anon},
+            IT_BlackNodes | IT_AnonStructs, IT_StructNames | IT_Node2StructID);
+        // Sikpped wierd GepStmts. (Stuck at somewhere. 2024.10.25)
+        auto byteoffset = graph.add("collectByteoffset", [&](){ collectByteoffset(pag, initThreads); }, {structIDs},
+            IT_AnonStructs | IT_Node2StructID, IT_NodeEdges | IT_StructNames | IT_Shortcuts | IT_GepInfos);
+        auto stores = graph.add("setupStores", [&](){ setupStores(pag); }, {byteoffset},
+            0, IT_NodeEdges | IT_Shortcuts | IT_AddShortcuts);
+        auto castSites = graph.add("processCastSites", [&](){ processCastSites(pag); }, {structIDs},
+            IT_Node2StructID, IT_CastSites);
+        graph.add("processCastMap", [&](){ processCastMap(pag); }, {},
+            0, IT_CastMap);
+        graph.add("finalizeGepInfos", [&](){ finalizeGepInfos(pag); }, {stores, castSites},
+            IT_Node2StructID | IT_Shortcuts | IT_CastSites, IT_GepInfos);
+        graph.run(initThreads);
+        if(!cachePath.empty()){
+            saveInitCache(cachePath, cacheKey, pag);
+        }
+    }else{
+        processCastMap(pag); // castmap以LLVM Type*为key，不进缓存，单趟遍历Copy边重建即可。
+    }
     errs() << "shortcuts setup in Unias! " << "\n\n";
+    // 所有分析用到的表都建好之后，冻结成只读的shortcut索引和CSR快照，分析线程只读它们。
+    u64_t rssBefore = getCurrentRSSKB();
+    shortcutIndex.build();
+    pagSnapshot.build(pag);
+    errs() << "[initialize] RSS before/after ShortcutIndex and PAGSnapshot: " << rssBefore / 1024 << "MB / " << getCurrentRSSKB() / 1024 << "MB\n\n";
 }
 
 // GlobalVariable* --> SVFGlobalValue*
@@ -146,7 +274,6 @@ bool getSpecificGV(SVFModule* svfModule, string name) {
 }
 
 // 筛选内核中的初始化函数，用于辅助判断是否protectable
-unordered_set<string> NewInitFuncstr; // Also used for checkIfProtectable().
 void getNewInitFuncs(){
     string NewInitFuncsFilePath = InputNewInitFuncs();
     if(NewInitFuncsFilePath.size() == 0) {
@@ -169,25 +296,27 @@ void getNewInitFuncs(){
 
 // Alias分析结果后处理。（Added by LHY）
 // 遍历Unias别名分析结果，记录Protect/Written属性。
+// 依次检验一个field的所有alias节点是否可保护。
+static bool checkIfFieldProtectable(const AliasResult::Entry &entry) {
+    for (NodeID id : entry.nodes) {
+        if(!checkIfProtectable(pagSnapshot.getNode(id))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 map<s64_t, string> getGvWrittenInfo(UniasAlgo* unias) {
     map<s64_t, string> result;
-    for (const auto& pair : unias->Aliases) {// 遍历每个field。
-        s64_t byteOffset = pair.first;
-        const std::unordered_set<PAGNode*>& nodeSet = pair.second;
-        // 依次检验当前field的所有alias节点是否可保护。
-        bool ifProtectable = true;
-        for (const auto& node : nodeSet) {
-            if(!checkIfProtectable(node)) {
-                ifProtectable = false;
-                break;
-            }
-        }
+    for (const auto& entry : unias->Aliases) {// 遍历每个field。
+        s64_t byteOffset = entry.offset;
+        bool ifProtectable = checkIfFieldProtectable(entry);
         if (ifProtectable) {
             result.emplace(byteOffset, "Protect");
         } else {
             result.emplace(byteOffset, "Written");
         }
-        // fout << "Offset: " << byteOffset << (ifProtectable ? " [Protect] ":" [Written] ") << ";\tAliasNum: " << nodeSet.size() << endl;
+        // fout << "Offset: " << byteOffset << (ifProtectable ? " [Protect] ":" [Written] ") << ";\tAliasNum: " << entry.nodes.size() << endl;
     }
     return result;
 } 
@@ -228,7 +357,7 @@ void postProcessResults(UniasAlgo* unias, SVFGlobalValue* gv, ofstream &fout) {
         }
         splitters.push_back(gvAllSize); 
         vector<s64_t> AliasesKeys;
-        for (const auto& pair : unias->Aliases) { AliasesKeys.push_back(pair.first); }
+        for (const auto& entry : unias->Aliases) { AliasesKeys.push_back(entry.offset); }
         // 把splitters和AliasesKeys都在一个vector里排列并记录来源。
         std::vector<std::pair<s64_t, std::string>> combinedSeq;
         for (s64_t a : splitters) {
@@ -259,7 +388,7 @@ void postProcessResults(UniasAlgo* unias, SVFGlobalValue* gv, ofstream &fout) {
                 } 
             } else if (tag=="B") {
                 output += ("\tbyteOffset: " + std::to_string(offset) + " ["+uniasRes[offset]+"]");
-                output += (";\tAliasNum: " + std::to_string(unias->Aliases[offset].size()) + "\n");
+                output += (";\tAliasNum: " + std::to_string(unias->Aliases.numNodes(offset)) + "\n");
             }
         }
         // TODO: 按结构体的original index列可保护比例。
@@ -270,7 +399,7 @@ void postProcessResults(UniasAlgo* unias, SVFGlobalValue* gv, ofstream &fout) {
             s64_t byteOffset = pair.first;
             auto  tag = pair.second;
             output += ("\tbyteOffset: " + std::to_string(byteOffset) + " ["+tag+"]");
-            output += (";\tAliasNum: " + std::to_string(unias->Aliases[byteOffset].size()) + "\n");
+            output += (";\tAliasNum: " + std::to_string(unias->Aliases.numNodes(byteOffset)) + "\n");
         }
         output += "Protectable Ratio: " + std::to_string(protectableOffsets.size()) + "/" + std::to_string(unias->Aliases.size()) + "\n";
     } 
@@ -282,53 +411,85 @@ void postProcessResults(UniasAlgo* unias, SVFGlobalValue* gv, ofstream &fout) {
     fout << endl << flush;
     fout.flush();
 }
-void postProcessResults_old(UniasAlgo* unias, const SVFGlobalValue* gv, ofstream &fout) { // 老版输出
+void postProcessResults_old(const GVResult &result, ofstream &fout) { // 老版输出
     // (old)输出格式为：全局变量名 + 
     // 可保护的filed占所有Aliases里fileds的比例 +
     // 各个可保护的field的byteOffset值。
-    unsigned allFieldNum = unias->Aliases.size();
+    unsigned allFieldNum = result.fields.size();
     set<s64_t> protectableOffsets;
-    for (const auto& pair : unias->Aliases) {
-        s64_t offset = pair.first;
-        const std::unordered_set<PAGNode*>& nodeSet = pair.second;
-        // 依次检验当前field的所有alias节点是否可保护。
-        bool ifProtectable = true;
-        for (const auto& node : nodeSet) {
-            if(!checkIfProtectable(node)) {
-                ifProtectable = false;
-                break;
-            }
-        }
-        if (ifProtectable) {
-            protectableOffsets.insert(offset);
+    for (const auto& field : result.fields) {
+        if (field.protectable) {
+            protectableOffsets.insert(field.offset);
         }
     }
-    string output = gv->getName() + "\n";
+    string output = result.gv + "\n";
     output += std::to_string(protectableOffsets.size()) + "/" + std::to_string(allFieldNum) + "\n";
     for(auto s : protectableOffsets) {
         output += std::to_string(s) + "\n";
     }
-    fout << output << endl;
-    fout << endl << flush;
-    fout.flush();
+    // 预算耗尽提前结束的GV：上面只是部分结果，附上原因和目前到达过的所有offset。
+    if(result.truncated != TruncNone) {
+        output += "Truncated: " + string(truncReasonName(result.truncated)) + ", steps " + std::to_string(result.steps)
+            + ", " + std::to_string(result.timeUs / 1000) + "ms, offsets reached:";
+        for (const auto& field : result.fields) {
+            output += " " + std::to_string(field.offset);
+        }
+        output += "\n";
+    }
+    fout << output << "\n\n"; // 每个worker独占一个文件，不必逐条flush。
+}
+
+// 结构化的结果，ResultOutput、ResultCacheDir和老版输出都用它。
+static GVResult makeGVResult(const string &name, const AliasResult &aliases) {
+    GVResult result;
+    result.gv = name;
+    result.fields.reserve(aliases.size());
+    for (const auto& entry : aliases) {
+        result.fields.push_back(GVResult::Field{entry.offset, (u32_t)entry.nodes.size(), checkIfFieldProtectable(entry)});
+    }
+    return result;
+}
+
+static GVResult makeGVResult(UniasAlgo* unias, const SVFGlobalValue* gv) {
+    GVResult result = makeGVResult(gv->getName(), unias->Aliases);
+    result.truncated = unias->truncated;
+    result.timeUs = unias->analysisUs;
+    result.steps = unias->traversal.stepsDone;
+    return result;
 }
 
-UniasAlgo* performAnalysis(const SVFGlobalValue* gv, SVFIR* pag){
+// 所有worker共享的遍历摘要缓存，SummaryCacheMB为0时不创建。
+static SummaryCache* summaryCache = nullptr;
+
+// 所有worker共享的shortcut展开结果，ShortcutCacheMB为0时不创建。
+static ShortcutCache* shortcutCache = nullptr;
+
+// 设置了IncrementalDir时的依赖记录。
+static IncrementalSession incremental;
+
+// 设置了ResultCacheDir时的per-GV结果缓存。
+static ResultCache resultCache;
+
+UniasAlgo* performAnalysis(const SVFGlobalValue* gv, SVFIR* pag, const AliasBudget &budget){
     // 每分析一个GV，就构建一个UniasAlgo实例。
+    // 每个worker线程一份workspace，在它分析的各个GV之间复用。
+    static thread_local AliasWorkspace workspace;
     auto* unias = new UniasAlgo();
     unias->pag = pag;
+    unias->workspace = &workspace;
+    unias->summaries = summaryCache;
+    unias->shortcuts = shortcutCache;
+    unias->dedupStates = StateDedup();
+    unias->trackEntered = IncrementalDir() != "" || resultCache.isOpen();
     auto llvmGv = getLLVMGlobalVariable(gv);
     auto curLayout = llvmGv->getParent()->getDataLayout();
     unias->DL = &curLayout;
-    for(auto node : blackNodes){
-        unias->blackNodes.insert(node);
-    }
     PNwithOffset firstLayer(0 ,false);
     unias->AnalysisStack.push(firstLayer); // 分析栈中初始节点(os=0, cf=false)。
     // find the variable you want to query on the graph
     auto pgnode = pag->getGNode(pag->getValueNode(gv));
     unias->taskNode = pgnode;
-    unias->ComputeAlias(pgnode, false);
+    unias->ComputeAliasWithin(pgnode, false, budget);
     // Production `flows-to` is false, `I-Alias` is true
     // For global variables, we use `flows-to`
     // Aliases will be unias.Aliases, it's a field sensitive map
@@ -336,16 +497,76 @@ UniasAlgo* performAnalysis(const SVFGlobalValue* gv, SVFIR* pag){
     return unias;
 }
 
-void eachThread(SVFIR* pag, const SVFGlobalValue* gv, ofstream &fout){
+// 设置了MetricsOutput时，所有worker共用的per-GV统计输出。
+static GVMetricsWriter metricsWriter;
+
+// 设置了ResultOutput时，所有worker共用的结果输出。
+static ResultWriter resultWriter;
+
+// 返回该GV是否因预算耗尽而被截断。deferTruncated为true时，被截断的GV不输出，留给重试阶段。
+// fout没有打开（未设置OutputDir）时只输出到ResultOutput。
+TruncReason eachThread(SVFIR* pag, const SVFGlobalValue* gv, ofstream &fout, const AliasBudget &budget, bool deferTruncated){
     if (ThreadNum() == 1) printGVType(pag, gv); // For debug. // 但多线程同时往errs()里写东西可能有问题。
-    
-    auto res = performAnalysis(gv, pag);
+
+    // 遍历过的子图没有变化时直接用缓存的结果。命中的GV没有遍历统计，不写MetricsOutput。
+    GVResult result;
+    vector<NodeID> cachedEntered;
+    if (resultCache.isOpen() && resultCache.lookup(gv->getName(), pag->getValueNode(gv), result, cachedEntered)) {
+        if (VerboseLevel() >= 1) {
+            errs() << "[ResultCache] " << gv->getName() << ": hit, " << cachedEntered.size() << " nodes, offsets "
+                   << result.fields.size() << "\n";
+        }
+        if (fout.is_open()) {
+            postProcessResults_old(result, fout);
+        }
+        if (IncrementalDir() != "") {
+            incremental.record(gv->getName(), cachedEntered);
+        }
+        resultWriter.submit(std::move(result));
+        return TruncNone;
+    }
+
+    auto res = performAnalysis(gv, pag, budget);
+    const TruncReason truncated = res->truncated;
+    if (VerboseLevel() >= 1) {
+        const auto &m = res->metrics;
+        errs() << "[GVMetrics] " << gv->getName() << ": " << res->analysisUs / 1000 << "ms, calls " << m.calls
+               << ", rejects black/dyn/cap/edge/icall " << m.rejectBlack << "/" << m.rejectDynBlack << "/" << m.rejectEdgeCap
+               << "/" << m.rejectEdge << "/" << m.rejectIcall << ", shortcuts " << m.typebasedShortcuts << "/"
+               << m.additionalShortcuts << "/" << m.castSiteShortcuts << ", dynBlack " << m.dynBlackTriggers
+               << ", stack " << m.maxStackDepth << ", offsets " << res->Aliases.size()
+               << " (" << res->Aliases.memoryBytes() << " bytes)"
+               << (truncated != TruncNone ? ", truncated" : "") << "\n";
+    }
+    if (truncated != TruncNone && deferTruncated) {
+        delete res;
+        return truncated;
+    }
+    // 留给重试阶段的GV在重试时再写，MetricsOutput中每个GV只有一条记录。
+    metricsWriter.write(gv->getName(), *res);
     // auto llvmGv = getLLVMGlobalVariable(gv);
     // llvm::DataLayout curLayout(llvmGv->getParent());
     // res->DL = &curLayout; // 可能需要加，取决于DataLayout对象的生命周期。
     // postProcessResults(res, gv, fout);
-    postProcessResults_old(res, gv, fout);
+    if (fout.is_open() || resultWriter.isOpen() || resultCache.isOpen()) {
+        result = makeGVResult(res, gv);
+    }
+    if (fout.is_open()) {
+        postProcessResults_old(result, fout);
+    }
+    if (IncrementalDir() != "") {
+        if (truncated != TruncNone) {
+            incremental.drop(gv->getName());
+        } else {
+            incremental.record(gv->getName(), res->workspace->getEntered());
+        }
+    }
+    if (resultCache.isOpen()) {
+        resultCache.store(gv->getName(), res->workspace->getEntered(), result);
+    }
+    resultWriter.submit(std::move(result));
     delete res;
+    return truncated;
 
     // // Guoren的KallGraph相关代码。
     // set<string> targetcis;
@@ -363,56 +584,443 @@ void eachThread(SVFIR* pag, const SVFGlobalValue* gv, ofstream &fout){
     // }
 }
 
-class ThreadPool {
+// 
+// Work-stealing GV scheduler.
+// 
+
+// 每个worker的调度统计。时间单位均为微秒。
+struct WorkerStats {
+    u64_t tasks = 0;       // 分析完成的GV数。
+    u64_t claims = 0;      // 从自己队列批量领取任务的次数。
+    u64_t steals = 0;      // 成功从其他worker窃取的次数。
+    u64_t stolenTasks = 0; // 窃取到的GV总数。
+    u64_t queueWaitUs = 0; // 等待队列锁、领取/窃取任务所花的时间。
+    u64_t busyUs = 0;      // 实际分析GV（含结果输出）的时间。
+    u64_t idleUs = 0;      // 所有队列暂时为空、等待收尾的时间。
+    u64_t truncatedTime = 0;  // 超出时间预算被截断的GV数。
+    u64_t truncatedSteps = 0; // 超出步数预算被截断的GV数。
+};
+
+static inline u64_t elapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 每个worker持有一个双端队列：自己从队头批量领取，其他worker从队尾窃取一半。
+// 任务在启动前一次性分发完毕，此后只会减少，因此remaining归零即可退出。
+// 领取和窃取都失败而remaining不为零时，剩下的任务正被某个窃取者搬运，worker在条件变量上等到搬运完成或remaining归零。
+// 每个GV按budget分析；deferTruncated为true时被截断的GV不输出，记入getTruncated()留给重试阶段。
+// appendOutput为true时追加写各worker的输出文件（重试阶段），否则覆盖。
+class GVScheduler {
 public:
-    ThreadPool(size_t threadCount, SVFIR* pag, std::queue<const SVFGlobalValue*> &tasks) : stop(false), pag(pag), tasks(tasks) {
-        for (size_t i = 0; i < threadCount; ++i) {
-            workers.emplace_back([this] {
-                static int t = 0;
-                ofstream fout(OutputDir() + "/" + to_string(t++));
-                while (!stop) {
-                    while(!queueMutex.try_lock()){
-                        std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 5));
-                    }
-                    if(!this->tasks.empty()){
-                        const SVFGlobalValue* gv = this->tasks.front();
-                        this->tasks.pop();
-                        queueMutex.unlock();
-                        eachThread(this->pag, gv, fout); // 一个线程分析一个GV。
-                    }else{
-                        stop = true;
-                        queueMutex.unlock();
-                    }
-                }
-                fout.close();
-            });
+    GVScheduler(size_t threadCount, SVFIR* pag, const vector<const SVFGlobalValue*> &tasks, size_t batchSize,
+                const AliasBudget &budget = AliasBudget(), bool deferTruncated = false, bool appendOutput = false)
+        : pag(pag), batchSize(batchSize ? batchSize : 1), budget(budget), deferTruncated(deferTruncated),
+          appendOutput(appendOutput), queues(threadCount ? threadCount : 1), stats(queues.size()) {
+        // 按GV名排序后轮转分发，保证同样的输入得到同样的初始划分。
+        for (size_t i = 0; i < tasks.size(); i++) {
+            queues[i % queues.size()].tasks.push_back(tasks[i]);
         }
-        
+        remaining = tasks.size();
     }
 
-    void WaitAll() {
-        for(auto &worker : workers){
+    void run() {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < queues.size(); i++) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+        for (auto &worker : workers) {
             worker.join();
         }
+        wallUs = elapsedUs(start);
+        // 先退出的worker在等待最慢的GV收尾期间也算作空闲。
+        for (auto &st : stats) {
+            if (wallUs > st.busyUs + st.queueWaitUs + st.idleUs) {
+                st.idleUs = wallUs - st.busyUs - st.queueWaitUs;
+            }
+        }
+    }
+
+    void printSummary() const {
+        WorkerStats total;
+        for (size_t i = 0; i < stats.size(); i++) {
+            const auto &st = stats[i];
+            errs() << "[GVScheduler] worker " << i << ": tasks " << st.tasks << ", claims " << st.claims
+                   << ", steals " << st.steals << " (" << st.stolenTasks << " GVs)"
+                   << ", queueWait " << st.queueWaitUs / 1000 << "ms, busy " << st.busyUs / 1000
+                   << "ms, idle " << st.idleUs / 1000 << "ms\n";
+            total.tasks += st.tasks;
+            total.steals += st.steals;
+            total.stolenTasks += st.stolenTasks;
+            total.queueWaitUs += st.queueWaitUs;
+            total.busyUs += st.busyUs;
+            total.idleUs += st.idleUs;
+            total.truncatedTime += st.truncatedTime;
+            total.truncatedSteps += st.truncatedSteps;
+        }
+        errs() << "[GVScheduler] total: tasks " << total.tasks << ", steals " << total.steals
+               << " (" << total.stolenTasks << " GVs), queueWait " << total.queueWaitUs / 1000
+               << "ms, busy " << total.busyUs / 1000 << "ms, idle " << total.idleUs / 1000
+               << "ms, wall " << wallUs / 1000 << "ms, avg "
+               << (total.tasks ? total.busyUs / total.tasks : 0) << "us/GV\n";
+        if (!budget.unlimited()) {
+            errs() << "[GVScheduler] budget " << budget.timeUs / 1000 << "ms / " << budget.steps << " steps (0 = unlimited): truncated "
+                   << total.truncatedTime << " GVs by time, " << total.truncatedSteps << " GVs by steps"
+                   << (deferTruncated ? ", deferred to retry" : "") << "\n";
+        }
+    }
+
+    // 被截断的GV，按GV名排序。
+    vector<const SVFGlobalValue*> getTruncated() const {
+        vector<const SVFGlobalValue*> ret(truncatedGVs);
+        std::sort(ret.begin(), ret.end(), [](const SVFGlobalValue* a, const SVFGlobalValue* b) {
+            return a->getName() < b->getName();
+        });
+        return ret;
     }
 
 private:
-    std::vector<std::thread> workers;
-    std::queue<const SVFGlobalValue*> &tasks;
-    std::mutex queueMutex;
-    bool stop;
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<const SVFGlobalValue*> tasks;
+    };
+
+    // 从自己队列的队头领取最多batchSize个任务。队列快空时领得少一些，给窃取者留出余地。
+    // 领走的任务不能再被窃取，所以全局剩余不足每个worker一批时只领一个，避免几个GV排在一个耗时很长的GV后面。
+    bool claim(size_t self, vector<const SVFGlobalValue*> &batch) {
+        auto &q = queues[self];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (q.tasks.empty()) return false;
+        size_t n = remaining < queues.size() * batchSize ? 1 : std::min(batchSize, (q.tasks.size() + 1) / 2);
+        for (size_t i = 0; i < n; i++) {
+            batch.push_back(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        if ((remaining -= n) == 0) {
+            std::lock_guard<std::mutex> idleLock(idleMtx);
+            idleCv.notify_all();
+        }
+        return true;
+    }
+
+    // 从其他worker的队尾窃取一半任务（至少一个），放入自己的队列，之后照常领取。
+    // 窃取来的任务仍留在队列里，其他空闲worker还能继续从这里窃取。
+    bool steal(size_t self) {
+        for (size_t k = 1; k < queues.size(); k++) {
+            auto &victim = queues[(self + k) % queues.size()];
+            std::deque<const SVFGlobalValue*> stolen;
+            {
+                std::lock_guard<std::mutex> lock(victim.mtx);
+                if (victim.tasks.empty()) continue;
+                size_t n = std::max<size_t>(1, victim.tasks.size() / 2);
+                for (size_t i = 0; i < n; i++) {
+                    stolen.push_front(victim.tasks.back());
+                    victim.tasks.pop_back();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(queues[self].mtx);
+                queues[self].tasks.insert(queues[self].tasks.end(), stolen.begin(), stolen.end());
+            }
+            {
+                std::lock_guard<std::mutex> idleLock(idleMtx);
+                transfers++;
+                idleCv.notify_all();
+            }
+            stats[self].steals++;
+            stats[self].stolenTasks += stolen.size();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t id) {
+        auto &st = stats[id];
+        ofstream fout;
+        if (!OutputDir().empty()) {
+            fout.open(OutputDir() + "/" + to_string(id), appendOutput ? ios::app : ios::out); // 每个worker固定一个输出文件。
+        }
+        vector<const SVFGlobalValue*> batch;
+        while (true) {
+            auto waitStart = std::chrono::steady_clock::now();
+            batch.clear();
+            // 在扫描队列之前记下搬运次数：扫描时还在路上的任务放进队列后transfers一定会变。
+            u64_t seenTransfers;
+            {
+                std::lock_guard<std::mutex> idleLock(idleMtx);
+                seenTransfers = transfers;
+            }
+            bool got = claim(id, batch);
+            if (!got && steal(id)) {
+                st.queueWaitUs += elapsedUs(waitStart);
+                continue;
+            }
+            st.queueWaitUs += elapsedUs(waitStart);
+            if (!got) {
+                // 所有任务都已被领取，剩下的只是等待其他worker收尾。
+                if (remaining == 0) break;
+                // 其他worker正在搬运任务，等它放进队列后再试。
+                auto idleStart = std::chrono::steady_clock::now();
+                {
+                    std::unique_lock<std::mutex> idleLock(idleMtx);
+                    idleCv.wait(idleLock, [&] { return transfers != seenTransfers || remaining == 0; });
+                }
+                st.idleUs += elapsedUs(idleStart);
+                continue;
+            }
+            st.claims++;
+            for (auto gv : batch) {
+                auto busyStart = std::chrono::steady_clock::now();
+                auto truncated = eachThread(pag, gv, fout, budget, deferTruncated); // 一个线程分析一个GV。
+                st.busyUs += elapsedUs(busyStart);
+                st.tasks++;
+                if (truncated != TruncNone) {
+                    (truncated == TruncTime ? st.truncatedTime : st.truncatedSteps)++;
+                    std::lock_guard<std::mutex> lock(truncatedMtx);
+                    truncatedGVs.push_back(gv);
+                }
+            }
+        }
+        fout.close();
+    }
+
     SVFIR* pag;
+    size_t batchSize;
+    AliasBudget budget;
+    bool deferTruncated;
+    bool appendOutput;
+    std::vector<WorkerQueue> queues;
+    std::vector<WorkerStats> stats;
+    std::atomic<size_t> remaining;
+    std::mutex idleMtx;
+    std::condition_variable idleCv;
+    u64_t transfers = 0; // 完成的窃取次数，由idleMtx保护。
+    u64_t wallUs = 0;
+    std::mutex truncatedMtx;
+    vector<const SVFGlobalValue*> truncatedGVs;
 };
 
-void analysisUnias(SVFModule *M, SVFIR* pag, size_t threadcount){
-    std::queue<const SVFGlobalValue*> tasks;
-    for(auto gv : analysisScope){
-        tasks.push(gv);
+//
+// Bit-parallel batches.
+//
+
+// 每批GV的结果。整批共用一次遍历，time_us和steps记的是整批的耗时和展开的状态数。
+static void outputBatch(const BatchAlias &batch, const vector<const SVFGlobalValue*> &gvs, ofstream &fout) {
+    for (size_t lane = 0; lane < gvs.size(); lane++) {
+        GVResult result = makeGVResult(gvs[lane]->getName(), batch.Aliases[lane]);
+        result.timeUs = batch.analysisUs;
+        result.steps = batch.metrics.states;
+        if (fout.is_open()) {
+            postProcessResults_old(result, fout);
+        }
+        resultWriter.submit(std::move(result));
+    }
+}
+
+// 用BatchAlias成批分析tasks，每批最多lanes个GV。节点类型指向同一结构体的GV排在一起，它们可达的子图大多相同。
+// 各worker从共享的下标领取整批，输出写到OutputDir下的batch-<id>。批的预算是单个GV预算乘以批大小，
+// 被截断的批不输出，其中的GV返回给per-GV引擎重新分析。
+static vector<const SVFGlobalValue*> analyzeInBatches(SVFIR* pag, vector<const SVFGlobalValue*> tasks, size_t threadcount,
+                                                      u32_t lanes, const AliasBudget &budget) {
+    std::stable_sort(tasks.begin(), tasks.end(), [pag](const SVFGlobalValue* a, const SVFGlobalValue* b) {
+        return getNodeStructID(pag->getValueNode(a)) < getNodeStructID(pag->getValueNode(b));
+    });
+    const size_t numBatches = (tasks.size() + lanes - 1) / lanes;
+    AliasBudget batchBudget;
+    batchBudget.timeUs = budget.timeUs * lanes;
+    batchBudget.steps = budget.steps * lanes;
+
+    std::atomic<size_t> nextBatch(0);
+    std::atomic<u64_t> totalStates(0), totalLaneSteps(0), busyUs(0);
+    std::mutex truncatedMtx;
+    vector<const SVFGlobalValue*> truncated;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t id = 0; id < std::max<size_t>(threadcount, 1); id++) {
+        workers.emplace_back([&, id] {
+            ofstream fout;
+            if (!OutputDir().empty()) {
+                fout.open(OutputDir() + "/batch-" + to_string(id));
+            }
+            BatchAlias batch;
+            vector<const SVFGlobalValue*> gvs;
+            vector<PAGNode*> roots;
+            for (size_t b; (b = nextBatch++) < numBatches;) {
+                auto busyStart = std::chrono::steady_clock::now();
+                gvs.assign(tasks.begin() + b * lanes, tasks.begin() + std::min(tasks.size(), (b + 1) * lanes));
+                roots.clear();
+                for (auto gv : gvs) {
+                    roots.push_back(pag->getGNode(pag->getValueNode(gv)));
+                }
+                if (batch.run(roots, batchBudget)) {
+                    outputBatch(batch, gvs, fout);
+                } else {
+                    std::lock_guard<std::mutex> lock(truncatedMtx);
+                    truncated.insert(truncated.end(), gvs.begin(), gvs.end());
+                }
+                totalStates += batch.metrics.states;
+                totalLaneSteps += batch.metrics.laneSteps;
+                busyUs += elapsedUs(busyStart);
+                if (VerboseLevel() >= 1) {
+                    errs() << "[BatchAlias] batch " << b << ": " << gvs.size() << " GVs, " << batch.analysisUs << "us, levels "
+                           << batch.metrics.levels << ", states " << batch.metrics.states << ", lane steps " << batch.metrics.laneSteps
+                           << ", merged " << batch.metrics.merged << (batch.truncated != TruncNone ? ", truncated" : "") << "\n";
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    std::sort(truncated.begin(), truncated.end(), [](const SVFGlobalValue* a, const SVFGlobalValue* b) {
+        return a->getName() < b->getName();
+    });
+    errs() << "[BatchAlias] " << tasks.size() << " GVs in " << numBatches << " batches of " << lanes << ": states " << totalStates
+           << ", lane steps " << totalLaneSteps << " (x" << format("%.2f", totalStates ? (double)totalLaneSteps / totalStates : 0.0)
+           << " shared), busy " << busyUs / 1000 << "ms, wall " << elapsedUs(start) / 1000 << "ms, "
+           << truncated.size() << " GVs of truncated batches left to the per-GV engine\n";
+    return truncated;
+}
+
+// 增量模式的配置key：除bc文件之外，会影响分析结果的输入文件内容和选项。
+static u64_t computeIncrementalConfigKey() {
+    string config = to_string(INCREMENTAL_VERSION) + " " + to_string(BASE_NUM) + " " + to_string(O_BASE) + " "
+        + to_string(SC_THRESHOLD) + " " + to_string(STAT_THRESHOLD) + " " + to_string(MAX_PATH_EDGES) + " "
+        + to_string(GVTimeBudgetMs()) + " " + to_string(GVStepBudget()) + " " + to_string(GVRetryScale()) + " "
+        + to_string(StateDedup()) + " " + SpecificGV();
+    for (const auto &file : {SVFIRJsonInput(), CallGraphPath(), AllocDenyList(), InputNewInitFuncs()}) {
+        config += " " + to_string(hashFileContent(file));
+    }
+    return hashBytes(config.data(), config.size());
+}
+
+// 结果缓存的配置key：会改变遍历方式、又不体现在子图签名里的编译期阈值和选项。
+static u64_t computeResultCacheConfigKey() {
+    string config = to_string(RESULT_CACHE_VERSION) + " " + to_string(BASE_NUM) + " " + to_string(O_BASE) + " "
+        + to_string(SC_THRESHOLD) + " " + to_string(STAT_THRESHOLD) + " " + to_string(MAX_PATH_EDGES) + " "
+        + to_string(StateDedup());
+    return hashBytes(config.data(), config.size());
+}
+
+// 增量模式：上一次结果里依赖没有变化的GV直接复用（按名字整组判断，同名的GV共用依赖和结果），返回仍需分析的GV。
+// 上一次被截断的GV没有保存依赖（见IncrementalSession::drop），needsRerun总是为true，不会复用部分结果。
+static vector<const SVFGlobalValue*> reusePreviousResults(const vector<const SVFGlobalValue*> &tasks) {
+    ResultReader previous;
+    const bool havePrevious = resultWriter.isOpen() && previous.open(incremental.previousResultsPath());
+    vector<const SVFGlobalValue*> rerun;
+    vector<string> records;
+    size_t reused = 0;
+    for (size_t i = 0, j; i < tasks.size(); i = j) {
+        const string name = tasks[i]->getName();
+        for (j = i + 1; j < tasks.size() && tasks[j]->getName() == name; j++);
+        if (havePrevious && !incremental.needsRerun(name) && previous.read(name, records) && !records.empty()) {
+            for (auto &record : records) {
+                GVResult result;
+                result.gv = name;
+                result.record = std::move(record);
+                resultWriter.submit(std::move(result));
+            }
+            incremental.reuse(name);
+            reused += j - i;
+        } else {
+            rerun.insert(rerun.end(), tasks.begin() + i, tasks.begin() + j);
+        }
+    }
+    errs() << "[Incremental] Reuse " << reused << " GVs, re-analyze " << rerun.size() << " GVs\n";
+    return rerun;
+}
+
+static bool copyFile(const string &from, const string &to) {
+    ifstream fin(from, ios::in | ios::binary);
+    ofstream fout(to, ios::out | ios::trunc | ios::binary);
+    if (!fin.is_open() || !fout.is_open() || !(fout << fin.rdbuf())) {
+        errs() << "[analysisUnias] Fail to copy " << from << " to " << to << "\n";
+        return false;
+    }
+    return true;
+}
+
+void analysisUnias(SVFModule *M, SVFIR* pag, size_t threadcount, const std::vector<std::string> &moduleNameVec){
+    vector<const SVFGlobalValue*> tasks(analysisScope.begin(), analysisScope.end());
+    std::sort(tasks.begin(), tasks.end(), [](const SVFGlobalValue* a, const SVFGlobalValue* b) {
+        return a->getName() < b->getName();
+    });
+    
+    // 摘要拼接进来的子树不会经过markEntered，记不全依赖和子图，增量模式和结果缓存都不用摘要。
+    if(SummaryCacheMB() > 0 && (IncrementalDir() != "" || ResultCacheDir() != "")){
+        errs() << "[analysisUnias] SummaryCacheMB is ignored with IncrementalDir or ResultCacheDir\n";
+    }else if(SummaryCacheMB() > 0){
+        summaryCache = new SummaryCache((size_t)SummaryCacheMB() << 20, SummaryMinSteps(), nodeIDBound);
+    }
+    // 拼接进来的shortcut展开同样不经过markEntered。
+    if(ShortcutCacheMB() > 0 && (IncrementalDir() != "" || ResultCacheDir() != "")){
+        errs() << "[analysisUnias] ShortcutCacheMB is ignored with IncrementalDir or ResultCacheDir\n";
+    }else if(ShortcutCacheMB() > 0){
+        shortcutCache = new ShortcutCache((size_t)ShortcutCacheMB() << 20, ShortcutMaxSteps());
     }
     
-    errs() << "[analysisUnias] ThreadPool starts working!\n";
-    ThreadPool pool(threadcount, pag, tasks);
-    pool.WaitAll();
+    if(MetricsOutput() != ""){
+        metricsWriter.open(MetricsOutput());
+    }
+    if(ResultCacheDir() != "" && resultCache.open(ResultCacheDir(), computeResultCacheConfigKey())){
+        resultCache.buildLabels();
+    }
+    // 增量模式下结果总是写到IncrementalDir，供下一次复用，结束后再复制到ResultOutput。
+    if(IncrementalDir() != ""){
+        incremental.begin(IncrementalDir(), moduleNameVec, computeIncrementalConfigKey(), std::max<u32_t>(1, InitThreads()));
+        incremental.buildSymbols();
+        resultWriter.open(incremental.pendingResultsPath(), ResultQueue());
+        tasks = reusePreviousResults(tasks);
+    }else if(ResultOutput() != ""){
+        resultWriter.open(ResultOutput(), ResultQueue());
+    }
+
+    AliasBudget budget;
+    budget.timeUs = (u64_t)GVTimeBudgetMs() * 1000;
+    budget.steps = GVStepBudget();
+    const bool retry = !budget.unlimited() && GVRetryScale() > 0;
+
+    // 批量遍历不记录各GV进入过的节点，增量模式和结果缓存下仍用per-GV引擎。
+    if(BatchLanes() > 0 && (IncrementalDir() != "" || ResultCacheDir() != "")){
+        errs() << "[analysisUnias] BatchLanes is ignored with IncrementalDir or ResultCacheDir\n";
+    }else if(BatchLanes() > 0 && !tasks.empty()){
+        tasks = analyzeInBatches(pag, tasks, threadcount, std::min<u32_t>(BatchLanes(), BATCH_LANES), budget);
+    }
+
+    errs() << "[analysisUnias] GVScheduler starts working!\n";
+    GVScheduler scheduler(threadcount, pag, tasks, TaskBatch(), budget, retry);
+    scheduler.run();
+    scheduler.printSummary();
+
+    // 所有worker都跑完第一遍后，用放大的预算重跑被截断的GV，结果追加到各worker的输出文件和ResultOutput。
+    // 重跑仍被截断的GV按部分结果输出。
+    if(retry){
+        auto retryTasks = scheduler.getTruncated();
+        if(!retryTasks.empty()){
+            AliasBudget retryBudget;
+            retryBudget.timeUs = budget.timeUs * GVRetryScale();
+            retryBudget.steps = budget.steps * GVRetryScale();
+            errs() << "[analysisUnias] Retry " << retryTasks.size() << " truncated GVs with budgets x" << GVRetryScale() << "\n";
+            GVScheduler retryScheduler(threadcount, pag, retryTasks, 1, retryBudget, false, true);
+            retryScheduler.run();
+            retryScheduler.printSummary();
+        }
+    }
+    metricsWriter.close();
+    resultWriter.close();
+    if(IncrementalDir() != "" && incremental.finish() && ResultOutput() != ""){
+        copyFile(incremental.previousResultsPath(), ResultOutput());
+    }
+    if(summaryCache){
+        summaryCache->printStats();
+    }
+    if(shortcutCache){
+        shortcutCache->printStats();
+    }
+    resultCache.printStats();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    errs() << "[analysisUnias] RSS " << getCurrentRSSKB() / 1024 << "MB, peak " << usage.ru_maxrss / 1024 << "MB\n";
 }
 
 int main(int argc, char **argv) {
@@ -428,10 +1036,34 @@ int main(int argc, char **argv) {
     errs() << "SVFIRJsonOutput: " << SVFIRJsonOutput() << "\n";
     errs() << "CallGraphPath: " << CallGraphPath() << "\n";
     errs() << "SpecificGV: " << SpecificGV() <<"\n";
-    errs() << "OutputDir: " << OutputDir() << "\n";
+    errs() << "OutputDir: " << OutputDir() << ", ResultOutput: " << ResultOutput() << ", IncrementalDir: " << IncrementalDir()
+           << ", ResultCacheDir: " << ResultCacheDir() << "\n";
+    errs() << "PrefetchThreads: " << PrefetchThreads() << "\n";
+    errs() << "InitThreads: " << InitThreads() << "\n";
     errs() << "ThreadNum: " << ThreadNum() << "\n";
+    errs() << "TaskBatch: " << TaskBatch() << "\n";
+    errs() << "SummaryCacheMB: " << SummaryCacheMB() << ", ShortcutCacheMB: " << ShortcutCacheMB() << ", StateDedup: " << StateDedup() << ", BatchLanes: " << BatchLanes() << "\n";
+    errs() << "GVTimeBudgetMs: " << GVTimeBudgetMs() << ", GVStepBudget: " << GVStepBudget() << ", GVRetryScale: " << GVRetryScale() << "\n";
+    if(StateDedup()){
+        errs() << "[StateDedup] Experimental: pruning by (node, stack, state) is an approximation and may lose aliases; compare against a run without it.\n";
+    }
     errs() << "Start Unias Analysis!\n\n";
 
+    // 并发预读：只把bc文件读进page cache并提前剔除读不到的文件，解析仍由SVF串行完成；
+    // PrefetchVerify时还报告解析/校验失败和耗时最长的模块。
+    if(PrefetchThreads() > 0 && !moduleNameVec.empty()) {
+        auto prefetchStart = std::chrono::steady_clock::now();
+        auto loadStats = prefetchModules(moduleNameVec, PrefetchThreads(), PrefetchVerify());
+        printPrefetchStats(loadStats, elapsedUs(prefetchStart), PrefetchThreads());
+        // 读不到或解析失败的模块SVF加载时也只会报错跳过，这里直接剔除；没通过Verifier的模块只报告，仍交给SVF。
+        moduleNameVec.clear();
+        for(auto &st : loadStats) {
+            if(st.loadable) {
+                moduleNameVec.push_back(st.path);
+            }
+        }
+    }
+
     // Load and build.
     SVFIR* pag;
     SVFModule* svfModule;
@@ -459,7 +1091,7 @@ int main(int argc, char **argv) {
     // }
 
     // Unias customizations.
-    initialize(pag, svfModule);
+    initialize(pag, svfModule, moduleNameVec);
     errs() << "Finish initialize!\n\n"; errs().flush();
 
     // Obtain the analysis scope.
@@ -476,9 +1108,12 @@ int main(int argc, char **argv) {
         }
     }
 
+    // NewInitFuncstr已经读入，预计算各节点的checkIfProtectable结果。
+    setupProtectability(pag, std::max<u32_t>(1, InitThreads()));
+
     errs() << "\n[Analysis Phase] Analysis Scope: " << analysisScope.size() << "\n"; errs().flush();
     
-    analysisUnias(svfModule, pag, ThreadNum());
+    analysisUnias(svfModule, pag, ThreadNum(), moduleNameVec);
     
     errs() << "All Unias Analysis finished!\n";
 	return 0;
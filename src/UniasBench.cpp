@@ -0,0 +1,672 @@
+#include "SVFIR/PAGBuilderFromFile.h"
+#include "Util/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "include/BatchAlias.hpp"
+#include "include/GVMetrics.hpp"
+#include "include/UniasAlgo.hpp"
+#include "include/Util.hpp"
+
+using namespace llvm;
+using namespace SVF;
+
+//
+// UniasBench：不依赖内核bitcode，在进程内生成各种形状的合成PAG，对每个"GV"（各形状的根节点）运行UniasAlgo::ComputeAlias，
+// 报告每个GV的耗时、访问节点数和堆分配次数，用来在本地发现ComputeAlias的性能回归。
+// 合成PAG先写成SVF的文本PAG格式，再用PAGBuilderFromFile读进来；initialize()中依赖LLVM的阶段
+// （collectByteoffset、handleAnonymousStruct、setupCallGraph等）由生成器直接填写对应的全局表代替。
+//
+
+const Option<std::string> BenchShapes("BenchShapes",
+    "Comma separated shapes to generate: copy-chain, store-load, nested-gep, phi-select, call-ret, cast, or all.", "all");
+
+const Option<u32_t> BenchScale("BenchScale",
+    "Size parameter of every shape (chain length, fan-out width, number of instances/functions).", 64);
+
+const Option<u32_t> BenchRoots("BenchRoots",
+    "Number of GVs (analysis roots) attached to each shape.", 4);
+
+const Option<u32_t> BenchSeed("BenchSeed",
+    "Seed of the random generator that places roots and extra edges.", 1);
+
+const Option<u32_t> BenchRepeat("BenchRepeat",
+    "Analyze every GV this many times and report the fastest run.", 3);
+
+const Option<bool> StateDedup("StateDedup",
+    "Experimental, may lose aliases: within a GV, skip a (node, analysis stack, state) already explored at the same or a shallower path depth. Its effect on alias sets has not been measured.", false);
+
+const Option<u32_t> ShortcutCacheMB("ShortcutCacheMB",
+    "Memory cap (MB) of the cross-GV cache of shortcut expansions, approximate, 0 disables it. Shared by all GVs and repeats.", 0);
+
+const Option<bool> BenchBatch("BenchBatch",
+    "Also analyze each shape's GVs with one BatchAlias traversal per 64 GVs and compare with the per-GV engine.", false);
+
+const Option<std::string> BenchPAGFile("BenchPAGFile",
+    "Write the generated PAG to this file in SVF's text PAG format before loading it.", "/tmp/unias-bench-pag.txt");
+
+const Option<std::string> MetricsOutput("MetricsOutput",
+    "Write per-GV hot-path metrics to this file (JSONL, or CSV if it ends with .csv).", "");
+
+//
+// 堆分配统计：替换全局operator new，ComputeAlias前后的差值就是分析一个GV的分配次数和字节数。
+//
+static std::atomic<u64_t> allocCount(0);
+static std::atomic<u64_t> allocBytes(0);
+
+void* operator new(size_t size){
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if(void* ptr = std::malloc(size ? size : 1)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept{
+    std::free(ptr);
+}
+
+//
+// 合成PAG的生成器。
+//
+struct BenchShape {
+    string name;
+    vector<NodeID> roots;
+};
+
+class SyntheticPAG {
+public:
+    SyntheticPAG(){
+        structs.push_back(""); // EMPTY_STRUCT_ID
+    }
+
+    StructID addStruct(const string &name){
+        structs.push_back(name);
+        return structs.size() - 1;
+    }
+
+    // st为节点类型所指向的结构体，INVALID_STRUCT_ID表示不指向结构体。
+    NodeID addNode(StructID st = INVALID_STRUCT_ID){
+        const NodeID id = nodeStructs.size() + 1; // 从1开始编号。
+        nodeStructs.push_back(st);
+        return id;
+    }
+
+    // kind为文本PAG格式中的边名，同一(src, kind, dst)只保留一条，与SVFIR合并重复边的行为一致。
+    bool addEdge(NodeID src, const string &kind, NodeID dst, s64_t offset = 0){
+        if(!edgeSet.insert(std::make_tuple(src, kind, dst)).second){
+            return false;
+        }
+        edges.push_back(TextEdge{src, kind, dst, offset});
+        return true;
+    }
+
+    void addCopy(NodeID src, NodeID dst){ addEdge(src, "copy", dst); }
+    void addLoad(NodeID src, NodeID dst){ addEdge(src, "load", dst); }
+    void addStore(NodeID src, NodeID dst){ addEdge(src, "store", dst); }
+    void addCall(NodeID actual, NodeID formal){ addEdge(actual, "call", formal); }
+    void addRet(NodeID ret, NodeID callsite){ addEdge(ret, "ret", callsite); }
+
+    // 常量offset（字节数）的GEP；variant为true时对应non-constant的GEP。
+    void addGep(NodeID src, NodeID dst, s64_t offset, bool variant = false){
+        if(addEdge(src, variant ? "variant-gep" : "gep", dst, offset)){
+            geps.push_back(GepDesc{src, dst, offset, variant});
+        }
+    }
+
+    // src与dst指向不同结构体的Copy边，即processCastSites收集的cast site。
+    void addCast(NodeID src, NodeID dst){
+        if(addEdge(src, "copy", dst)){
+            casts.push_back(std::make_pair(src, dst));
+        }
+    }
+
+    // 文本PAG格式没有phi/select，用一条从第一个操作数到dst的unary-op边代替该语句，
+    // 它只作为phiIn/phiOut、selectIn/selectOut中的边对象，ComputeAlias不会沿unary-op边遍历。
+    void addPhi(NodeID dst, const vector<NodeID> &opnds, bool select){
+        assert(!opnds.empty());
+        addEdge(opnds[0], "unary-op", dst);
+        phis.push_back(PhiDesc{dst, opnds, select});
+    }
+
+    // 间接调用：由setupCallGraph写入的实参/形参、返回值/callsite映射。
+    void addIndirectCall(NodeID actual, NodeID formal){
+        realFormal.push_back(std::make_pair(actual, formal));
+    }
+
+    void addIndirectRet(NodeID ret, NodeID callsite){
+        retCall.push_back(std::make_pair(ret, callsite));
+    }
+
+    u32_t numNodes() const { return nodeStructs.size(); }
+    u32_t numEdges() const { return edges.size(); }
+
+    bool write(const string &path) const;
+
+    // 读入PAG之后，代替initialize()填写分析用到的各张全局表，并冻结shortcutIndex和pagSnapshot。
+    void install(SVFIR* pag) const;
+
+private:
+    struct TextEdge {
+        NodeID src;
+        string kind;
+        NodeID dst;
+        s64_t offset;
+    };
+    struct GepDesc {
+        NodeID src;
+        NodeID dst;
+        s64_t offset;
+        bool variant;
+    };
+    struct PhiDesc {
+        NodeID dst;
+        vector<NodeID> opnds;
+        bool select;
+    };
+
+    vector<string> structs;
+    vector<StructID> nodeStructs; // 下标为NodeID - 1。
+    vector<TextEdge> edges;
+    set<std::tuple<NodeID, string, NodeID>> edgeSet;
+    vector<GepDesc> geps;
+    vector<pair<NodeID, NodeID>> casts;
+    vector<PhiDesc> phis;
+    vector<pair<NodeID, NodeID>> realFormal;
+    vector<pair<NodeID, NodeID>> retCall;
+};
+
+bool SyntheticPAG::write(const string &path) const{
+    ofstream fout(path);
+    if(!fout){
+        errs() << "[bench] Fail to open " << path << "\n";
+        return false;
+    }
+    for(NodeID id = 1; id <= nodeStructs.size(); id++){
+        fout << id << " v\n";
+    }
+    for(auto &edge : edges){
+        fout << edge.src << " " << edge.kind << " " << edge.dst << " " << edge.offset << "\n";
+    }
+    return (bool)fout;
+}
+
+static PAGEdge* findEdge(SVFIR* pag, NodeID src, NodeID dst, PAGEdge::PEDGEK kind){
+    for(auto edge : pag->getGNode(src)->getOutgoingEdges(kind)){
+        if(edge->getDstID() == dst){
+            return edge;
+        }
+    }
+    return nullptr;
+}
+
+void SyntheticPAG::install(SVFIR* pag) const{
+    // 对应getBlackNodes、setupCallAdmissibility：合成PAG里没有常量和需要屏蔽的callee，两张表都为空。
+    nodeIDBound = getNodeIDBound(pag);
+    blackNodes.clear();
+    blackNodes.resize(nodeIDBound);
+    blockedCallEdges.clear();
+
+    // 对应setupStructIDs。
+    structNames = structs;
+    node2StructID.assign(nodeIDBound, INVALID_STRUCT_ID);
+    for(NodeID id = 1; id <= nodeStructs.size() && id < nodeIDBound; id++){
+        node2StructID[id] = nodeStructs[id - 1];
+    }
+
+    // 对应collectByteoffset：offset直接取生成时的字节数，源结构体有名字时登记typebased shortcut。
+    EdgeID bound = 0;
+    for(auto const edge : pag->getSVFStmtSet(PAGEdge::Gep)){
+        bound = std::max(bound, edge->getEdgeID() + 1);
+    }
+    gepInfos.assign(bound, GepInfo{0, INVALID_STRUCT_ID, 0});
+    for(auto &gep : geps){
+        PAGEdge* edge = findEdge(pag, gep.src, gep.dst, PAGEdge::Gep);
+        if(!edge){
+            continue;
+        }
+        gepIn[edge->getDstNode()] = edge;
+        auto &info = gepInfos[edge->getEdgeID()];
+        if(gep.variant){
+            info.flags |= GEP_VARIANT;
+            continue;
+        }
+        info.offset = gep.offset;
+        info.flags |= GEP_HAS_OFFSET;
+        const StructID stID = getNodeStructID(gep.src);
+        if(stID != INVALID_STRUCT_ID && stID != EMPTY_STRUCT_ID){
+            typebasedShortcuts[stID][gep.offset].insert(edge);
+            reverseShortcuts[edge][gep.offset].insert(stID);
+        }
+    }
+
+    // 对应setupPhiEdges、setupSelectEdges。
+    for(auto &phi : phis){
+        SVFStmt* stmt = findEdge(pag, phi.opnds[0], phi.dst, PAGEdge::UnaryOp);
+        if(!stmt){
+            continue;
+        }
+        auto &in = phi.select ? selectIn : phiIn;
+        auto &out = phi.select ? selectOut : phiOut;
+        for(auto opnd : phi.opnds){
+            in[phi.dst][stmt].insert(opnd);
+            out[opnd][stmt].insert(phi.dst);
+        }
+    }
+
+    // 对应setupCallGraph。
+    for(auto &rf : realFormal){
+        Real2Formal[rf.first].insert(rf.second);
+        Formal2Real[rf.second].insert(rf.first);
+    }
+    for(auto &rc : retCall){
+        Ret2Call[rc.first].insert(rc.second);
+        Call2Ret[rc.second].insert(rc.first);
+    }
+    ifCallGraphSet = true;
+
+    setupStores(pag);
+
+    // 对应processCastSites。
+    for(auto &cast : casts){
+        PAGEdge* edge = findEdge(pag, cast.first, cast.second, PAGEdge::Copy);
+        if(!edge){
+            continue;
+        }
+        const auto srcID = getNodeStructID(cast.first);
+        if(srcID != INVALID_STRUCT_ID){
+            castSites[srcID].insert(edge);
+        }
+        const auto dstID = getNodeStructID(cast.second);
+        if(dstID != INVALID_STRUCT_ID){
+            castSites[dstID].insert(edge);
+        }
+    }
+
+    finalizeGepInfos(pag);
+    shortcutIndex.build();
+    pagSnapshot.build(pag);
+}
+
+//
+// 各种形状。每个形状先建好共享的结构，再挂上roots个根节点，根节点在结构中的入口由随机数决定。
+//
+
+// 长Copy链：链上每隔几个节点有一条向前跳的Copy边，路径数随长度增长，由MAX_PATH_EDGES截断。
+static void genCopyChain(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    const u32_t len = scale * 4;
+    vector<NodeID> chain;
+    for(u32_t i = 0; i < len; i++){
+        chain.push_back(gen.addNode());
+        if(i){
+            gen.addCopy(chain[i - 1], chain[i]);
+        }
+    }
+    for(u32_t i = 0; i + 8 < len; i += 4){
+        gen.addCopy(chain[i], chain[i + 2 + rng() % 6]);
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addCopy(gv, chain[rng() % len]);
+        shape.roots.push_back(gv);
+    }
+}
+
+// 宽Store/Load扇出：GV存入base的若干个别名，再从base的scale个别名中Load出来（规则1）。
+static void genStoreLoad(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    const NodeID base = gen.addNode();
+    vector<NodeID> slots;
+    for(u32_t i = 0; i < 4; i++){
+        slots.push_back(gen.addNode());
+        gen.addCopy(base, slots.back());
+    }
+    for(u32_t i = 0; i < scale; i++){
+        const NodeID reader = gen.addNode();
+        gen.addCopy(base, reader);
+        gen.addLoad(reader, gen.addNode());
+        // 其他值也写入同一位置，供反向Store边（规则2）遍历。
+        if(i % 4 == 0){
+            gen.addStore(gen.addNode(), slots[rng() % slots.size()]);
+        }
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addStore(gv, slots[rng() % slots.size()]);
+        shape.roots.push_back(gv);
+    }
+}
+
+// 深层嵌套结构体：每个实例是一条逐层GEP的链，最内层成员被Load后再存入另一个结构体的成员，
+// 因此会产生typebased shortcut（同一结构体同一offset的所有实例）和additional shortcut（setupStores）。
+static void genNestedGep(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    const u32_t depth = std::min<u32_t>(2 + scale / 32, 8);
+    vector<StructID> levels;
+    for(u32_t l = 0; l < depth; l++){
+        levels.push_back(gen.addStruct("struct.bench.nest" + std::to_string(l)));
+    }
+    const StructID alt = gen.addStruct("struct.bench.nest.alt");
+    vector<NodeID> bases, leaves;
+    for(u32_t i = 0; i < scale; i++){
+        NodeID cur = gen.addNode(levels[0]);
+        bases.push_back(cur);
+        for(u32_t l = 0; l < depth; l++){
+            const NodeID field = gen.addNode(l + 1 < depth ? levels[l + 1] : INVALID_STRUCT_ID);
+            gen.addGep(cur, field, 8 * (l + 1), i % 8 == 7 && l == 1);
+            cur = field;
+        }
+        leaves.push_back(cur);
+        const NodeID val = gen.addNode();
+        gen.addLoad(cur, val);
+        const NodeID altField = gen.addNode();
+        gen.addGep(gen.addNode(alt), altField, 8);
+        gen.addStore(val, altField);
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addStore(gv, leaves[rng() % scale]);
+        gen.addCopy(gv, bases[rng() % scale]);
+        shape.roots.push_back(gv);
+    }
+}
+
+// phi/select菱形串：s -> (a, b) -> phi/select -> s'，每个菱形使路径数翻倍。
+static void genPhiSelect(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    vector<NodeID> joins;
+    NodeID cur = gen.addNode();
+    joins.push_back(cur);
+    for(u32_t i = 0; i < scale; i++){
+        const NodeID a = gen.addNode();
+        const NodeID b = gen.addNode();
+        const NodeID join = gen.addNode();
+        gen.addCopy(cur, a);
+        gen.addCopy(cur, b);
+        gen.addPhi(join, {a, b}, i % 2 == 1);
+        joins.push_back(join);
+        cur = join;
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addCopy(gv, joins[rng() % joins.size()]);
+        shape.roots.push_back(gv);
+    }
+}
+
+// 过程间调用网：scale个函数，每个函数把形参经过若干callsite传给随机的callee，callee的返回值再流回本函数的返回值。
+// 每个函数的第三个callsite是间接调用（Real2Formal等映射），其余是直接Call/Ret边。
+static void genCallRet(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    vector<NodeID> formals, rets;
+    for(u32_t f = 0; f < scale; f++){
+        formals.push_back(gen.addNode());
+        rets.push_back(gen.addNode());
+    }
+    for(u32_t f = 0; f < scale; f++){
+        const NodeID local = gen.addNode();
+        gen.addCopy(formals[f], local);
+        gen.addCopy(local, rets[f]);
+        for(u32_t c = 0; c < 3; c++){
+            const u32_t callee = rng() % scale;
+            const NodeID actual = gen.addNode();
+            const NodeID result = gen.addNode();
+            gen.addCopy(local, actual);
+            if(c == 2){
+                gen.addIndirectCall(actual, formals[callee]);
+                gen.addIndirectRet(rets[callee], result);
+            }else{
+                gen.addCall(actual, formals[callee]);
+                gen.addRet(rets[callee], result);
+            }
+            gen.addCopy(result, rets[f]);
+        }
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addCall(gv, formals[rng() % scale]);
+        shape.roots.push_back(gv);
+    }
+}
+
+// cast密集的结构体层次：每个base对象被cast成某个derived结构体，两边都访问同一offset的成员，
+// 反向GEP时会同时展开typebased shortcut和castsite shortcut。
+static void genCast(SyntheticPAG &gen, BenchShape &shape, u32_t scale, u32_t roots, std::mt19937 &rng){
+    const StructID base = gen.addStruct("struct.bench.base");
+    vector<StructID> derived;
+    for(u32_t k = 0; k < 4; k++){
+        derived.push_back(gen.addStruct("struct.bench.derived" + std::to_string(k)));
+    }
+    vector<NodeID> baseFields;
+    for(u32_t i = 0; i < scale; i++){
+        const NodeID obj = gen.addNode(base);
+        const NodeID sub = gen.addNode(derived[i % derived.size()]);
+        gen.addCast(obj, sub);
+        const NodeID baseField = gen.addNode();
+        gen.addGep(obj, baseField, 8);
+        gen.addLoad(baseField, gen.addNode());
+        baseFields.push_back(baseField);
+        for(s64_t offset : {8, 16}){
+            const NodeID subField = gen.addNode();
+            gen.addGep(sub, subField, offset);
+            gen.addLoad(subField, gen.addNode());
+        }
+    }
+    for(u32_t r = 0; r < roots; r++){
+        const NodeID gv = gen.addNode();
+        gen.addStore(gv, baseFields[rng() % scale]);
+        shape.roots.push_back(gv);
+    }
+}
+
+typedef void (*ShapeGenerator)(SyntheticPAG&, BenchShape&, u32_t, u32_t, std::mt19937&);
+
+static const vector<pair<string, ShapeGenerator>> shapeGenerators = {
+    {"copy-chain", genCopyChain},
+    {"store-load", genStoreLoad},
+    {"nested-gep", genNestedGep},
+    {"phi-select", genPhiSelect},
+    {"call-ret", genCallRet},
+    {"cast", genCast},
+};
+
+static bool shapeSelected(const string &name, const string &selected){
+    if(selected == "all"){
+        return true;
+    }
+    std::stringstream ss(selected);
+    string item;
+    while(std::getline(ss, item, ',')){
+        if(item == name){
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// 测量。
+//
+struct GVBenchResult {
+    u64_t minUs = UINT64_MAX;
+    u64_t totalUs = 0;
+    u64_t calls = 0;
+    u64_t steps = 0;
+    u64_t allocs = 0;
+    u64_t allocBytes = 0;
+    u64_t aliasOffsets = 0;
+    u64_t aliasNodes = 0;
+    u64_t aliasBytes = 0;
+};
+
+static GVMetricsWriter metricsWriter;
+static AliasWorkspace workspace; // 与performAnalysis中每个worker的workspace一样，在所有GV之间复用。
+static ShortcutCache* shortcutCache = nullptr;
+
+// 分析一次GV，与Unias.cpp中的performAnalysis相同，只是没有LLVM的GlobalVariable和DataLayout。
+static void benchGV(SVFIR* pag, NodeID gvID, const string &name, bool last, GVBenchResult &res){
+    auto* unias = new UniasAlgo();
+    unias->pag = pag;
+    unias->workspace = &workspace;
+    unias->dedupStates = StateDedup();
+    unias->shortcuts = shortcutCache;
+    unias->DL = nullptr;
+    unias->AnalysisStack.push(PNwithOffset(0, false));
+    PAGNode* gv = pag->getGNode(gvID);
+    unias->taskNode = gv;
+
+    const u64_t allocsBefore = allocCount.load(std::memory_order_relaxed);
+    const u64_t bytesBefore = allocBytes.load(std::memory_order_relaxed);
+    unias->ComputeAlias(gv, false);
+    const u64_t allocs = allocCount.load(std::memory_order_relaxed) - allocsBefore;
+    const u64_t bytes = allocBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+    res.minUs = std::min(res.minUs, unias->analysisUs);
+    res.totalUs += unias->analysisUs;
+    // 分析是确定性的，各次的计数相同，只保留最后一次。
+    res.calls = unias->metrics.calls;
+    res.steps = unias->traversal.stepsDone;
+    res.allocs = allocs;
+    res.allocBytes = bytes;
+    res.aliasOffsets = unias->Aliases.size();
+    res.aliasNodes = unias->Aliases.totalNodes();
+    res.aliasBytes = unias->Aliases.memoryBytes();
+    if(last){
+        metricsWriter.write(name, *unias);
+    }
+    delete unias;
+}
+
+// 用BatchAlias成批分析一个形状的所有GV，与per-GV引擎的结果（perGV，与roots一一对应）比较。
+// 每批最多BATCH_LANES个GV，各批取repeat次中最快的一次。
+static void benchBatch(SVFIR* pag, const BenchShape &shape, const vector<GVBenchResult> &perGV, u32_t repeat){
+    static BatchAlias batch; // 与workspace一样跨批复用。
+    u64_t minUs = 0, states = 0, laneSteps = 0, merged = 0, aliasNodes = 0;
+    u32_t levels = 0, matching = 0;
+    for(size_t first = 0; first < shape.roots.size(); first += BATCH_LANES){
+        const size_t last = std::min(shape.roots.size(), first + BATCH_LANES);
+        vector<PAGNode*> roots;
+        for(size_t r = first; r < last; r++){
+            roots.push_back(pag->getGNode(shape.roots[r]));
+        }
+        u64_t batchUs = UINT64_MAX;
+        for(u32_t i = 0; i < repeat; i++){
+            batch.run(roots);
+            batchUs = std::min(batchUs, batch.analysisUs);
+        }
+        minUs += batchUs;
+        states += batch.metrics.states;
+        laneSteps += batch.metrics.laneSteps;
+        merged += batch.metrics.merged;
+        levels = std::max(levels, batch.metrics.levels);
+        for(size_t r = first; r < last; r++){
+            const auto &aliases = batch.Aliases[r - first];
+            aliasNodes += aliases.totalNodes();
+            if(aliases.size() == perGV[r].aliasOffsets && aliases.totalNodes() == perGV[r].aliasNodes){
+                matching++;
+            }
+        }
+    }
+    u64_t perGVUs = 0, perGVNodes = 0;
+    for(auto &res : perGV){
+        perGVUs += res.minUs;
+        perGVNodes += res.aliasNodes;
+    }
+    errs() << "[bench] " << shape.name << " batch: " << minUs << "us vs " << perGVUs << "us per-GV ("
+           << format("%.2f", minUs ? (double)perGVUs / minUs : 0.0) << "x), levels " << levels << ", states " << states
+           << ", lane steps " << laneSteps << ", merged " << merged << ", alias nodes " << aliasNodes << " vs " << perGVNodes
+           << ", " << matching << "/" << shape.roots.size() << " GVs with the same offsets and alias node counts\n";
+}
+
+int main(int argc, char **argv) {
+    OptionBase::parseOptions(argc, argv, "Synthetic-PAG microbenchmark for UniasAlgo::ComputeAlias.", "[options]");
+    const u32_t scale = std::max<u32_t>(BenchScale(), 2);
+    const u32_t repeat = std::max<u32_t>(BenchRepeat(), 1);
+    errs() << "BenchShapes: " << BenchShapes() << ", BenchScale: " << scale << ", BenchRoots: " << BenchRoots()
+           << ", BenchSeed: " << BenchSeed() << ", BenchRepeat: " << repeat << ", StateDedup: " << StateDedup()
+           << ", ShortcutCacheMB: " << ShortcutCacheMB() << ", BenchBatch: " << BenchBatch() << "\n";
+
+    // 所有形状作为互不相连的分量放在同一个PAG里。
+    std::mt19937 rng(BenchSeed());
+    SyntheticPAG gen;
+    vector<BenchShape> shapes;
+    for(auto &sg : shapeGenerators){
+        if(shapeSelected(sg.first, BenchShapes())){
+            shapes.emplace_back();
+            shapes.back().name = sg.first;
+            sg.second(gen, shapes.back(), scale, BenchRoots(), rng);
+        }
+    }
+    if(shapes.empty()){
+        errs() << "[bench] No shape selected by -BenchShapes=" << BenchShapes() << "\n";
+        return 1;
+    }
+    errs() << "[bench] Generated " << gen.numNodes() << " nodes, " << gen.numEdges() << " edges, " << shapes.size() << " shapes\n";
+    if(!gen.write(BenchPAGFile())){
+        return 1;
+    }
+
+    auto buildStart = std::chrono::steady_clock::now();
+    PAGBuilderFromFile builder(BenchPAGFile());
+    SVFIR* pag = builder.build();
+    gen.install(pag);
+    errs() << "[bench] PAG loaded and tables installed in "
+           << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - buildStart).count() << "ms\n";
+
+    if(ShortcutCacheMB() > 0){
+        shortcutCache = new ShortcutCache((size_t)ShortcutCacheMB() << 20, UINT64_MAX);
+    }
+    if(!MetricsOutput().empty() && !metricsWriter.open(MetricsOutput())){
+        errs() << "[bench] Fail to open metrics output " << MetricsOutput() << "\n";
+    }
+
+    for(auto &shape : shapes){
+        GVBenchResult total;
+        total.minUs = 0;
+        vector<GVBenchResult> perGV;
+        for(u32_t r = 0; r < shape.roots.size(); r++){
+            const string name = shape.name + "#" + std::to_string(r);
+            GVBenchResult res;
+            for(u32_t i = 0; i < repeat; i++){
+                benchGV(pag, shape.roots[r], name, i + 1 == repeat, res);
+            }
+            errs() << "[bench] " << name << ": " << res.minUs << "us (avg " << res.totalUs / repeat << "us), calls " << res.calls
+                   << ", steps " << res.steps << ", allocs " << res.allocs << " (" << res.allocBytes << " bytes), offsets "
+                   << res.aliasOffsets << ", alias nodes " << res.aliasNodes << " (" << res.aliasBytes << " bytes)\n";
+            total.minUs += res.minUs;
+            total.calls += res.calls;
+            total.steps += res.steps;
+            total.allocs += res.allocs;
+            total.allocBytes += res.allocBytes;
+            total.aliasNodes += res.aliasNodes;
+            total.aliasBytes += res.aliasBytes;
+            perGV.push_back(res);
+        }
+        errs() << "[bench] " << shape.name << " total: " << total.minUs << "us, calls " << total.calls << ", steps " << total.steps
+               << ", allocs " << total.allocs << " (" << total.allocBytes << " bytes), "
+               << format("%.1f", total.calls ? (double)total.minUs * 1000 / total.calls : 0.0) << "ns/call, alias nodes "
+               << total.aliasNodes << " (" << total.aliasBytes << " bytes)\n";
+        if(BenchBatch()){
+            benchBatch(pag, shape, perGV, repeat);
+        }
+    }
+    metricsWriter.close();
+    if(shortcutCache){
+        shortcutCache->printStats();
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef UNIAS_ALIASRESULT_H
+#define UNIAS_ALIASRESULT_H
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 一个GV的别名结果：byte offset -> 别名节点集合，代替原来的map<s64_t, unordered_set<PAGNode*>>。
+// 分析过程中每个offset只追加NodeID，缓冲区比上次整理时增长一倍才排序去重一次，
+// 因此占用不超过去重后结果的两倍左右，也没有逐个节点的堆分配。
+// finalize之后各offset按升序排列，每个offset的节点有序且唯一，此后才能遍历和查询。
+class AliasResult {
+public:
+    struct Entry {
+        s64_t offset;
+        vector<NodeID> nodes;
+        u32_t compacted; // nodes的前compacted项有序且唯一。
+    };
+    typedef vector<Entry>::const_iterator const_iterator;
+
+    void insert(s64_t offset, NodeID node);
+
+    // 对所有offset排序去重。ComputeAliasWithin结束时调用。
+    void finalize();
+
+    void clear();
+
+    // 以下查询要求已经finalize。
+    const_iterator begin() const { assert(finalized); return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    size_t size() const { return entries.size(); } // offset的个数。
+    bool empty() const { return entries.empty(); }
+    const Entry* find(s64_t offset) const;
+    size_t numNodes(s64_t offset) const {
+        const Entry* entry = find(offset);
+        return entry ? entry->nodes.size() : 0;
+    }
+    u64_t totalNodes() const;
+
+    size_t memoryBytes() const;
+
+private:
+    vector<Entry> entries; // 按offset升序。
+    size_t lastHit = 0;    // 上一次insert落在的entry，连续的记录大多是同一个offset。
+    bool finalized = true;
+
+    static void compact(Entry &entry);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef UNIAS_BATCHALIAS_H
+#define UNIAS_BATCHALIAS_H
+#include <vector>
+
+#include "UniasAlgo.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 位并行的多源遍历：一次遍历同时分析最多BATCH_LANES个GV，每个GV占LaneMask中的一位（lane）。
+// 遍历状态与StateDedup相同，是(节点, 分析栈, state, taken)，分析栈用StackPool哈希共享；每个状态带一个lane掩码，
+// 表示哪些GV能到达它。规则1/2/4的栈匹配、GEP的offset和shortcut只看状态本身，所以对整组lane只做一次，
+// 到达同一状态的GV共享之后的整棵子树（例如各子系统里的list_head、spinlock_t全局变量）。
+// 按路径深度分层做BFS，状态只把新到达的lane传给后继，因此每个(状态, lane)只展开一次，而且是在最浅的深度。
+// 与per-GV引擎（StateDedup）相比是近似：
+//   - 不检查路径上已走过的边和icall，环由状态去重截断；
+//   - 过程间映射（没有PAGEdge的step）也算一层路径深度；
+//   - 没有动态黑名单（STAT_THRESHOLD）。
+#define BATCH_LANES 64
+typedef u64_t LaneMask;
+
+// 一次遍历中已到达各状态的lane，run开始时reset。
+// 同时记录状态在下一层frontier中的位置，同一层里从不同前驱到达同一状态的lane合并成一项。
+struct LaneSlot {
+    u32_t nextLevel; // 状态在第nextLevel层的frontier中有一项，位置为nextPos。
+    u32_t nextPos;
+    LaneMask lanes;
+};
+typedef EpochStateTable<LaneSlot> LaneStates;
+
+// 一次批量遍历的统计。
+struct BatchMetrics {
+    u64_t states = 0;      // 展开的(状态, lane组)数，预算也按它计。
+    u64_t laneSteps = 0;   // 展开的(状态, lane)数，即per-GV引擎分别展开的次数之和。
+    u64_t edges = 0;       // 生成的后继数。
+    u64_t merged = 0;      // 后继并入同一层已有项的次数。
+    u64_t rejectBlack = 0; // 后继是静态blackNodes。
+    u64_t overflow = 0;    // 分析栈ID超出状态key的位数，后继被丢弃。
+    u32_t levels = 0;      // BFS的层数。
+};
+
+// 每次run分析一批GV。每个worker一份，跨批复用各张表和缓冲区。
+class BatchAlias {
+public:
+    // 从roots（最多BATCH_LANES个GV节点，第i个占lane i）开始遍历，与performAnalysis一样以flows-to（state为false）、
+    // 分析栈[(0, false)]开始。预算按BatchMetrics::states和时间计，耗尽时整批截断。遍历完整结束返回true。
+    bool run(const vector<PAGNode*> &roots, const AliasBudget &budget = AliasBudget());
+
+    vector<AliasResult> Aliases; // 每个lane一份，run结束后已finalize。
+    TruncReason truncated = TruncNone;
+    u64_t analysisUs = 0;
+    BatchMetrics metrics;
+
+private:
+    struct Item {
+        NodeID node;
+        StackID stack;
+        bool state;
+        bool taken;
+        LaneMask lanes; // 本层新到达的lane。
+    };
+
+    StackPool stacks;
+    LaneStates seen;
+    vector<Item> frontier; // 当前层。
+    vector<Item> next;     // 下一层。
+    u32_t level = 0;
+
+    void expand(const Item &item);
+    void addNext(NodeID nxt, StackID stack, bool state, bool taken, LaneMask lanes);
+    void enqueue(NodeID node, StackID stack, bool state, bool taken, LaneMask lanes);
+    StackID offsetTop(StackID stack, s64_t delta);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef UNIAS_GVMETRICS_H
+#define UNIAS_GVMETRICS_H
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "UniasAlgo.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 每个GV分析结束后输出一条AliasMetrics记录，用来找出占用大部分时间的GV及其原因。
+// 文件名以.csv结尾时输出CSV（第一行为表头），否则每行一个JSON对象（JSONL）。
+// 多个worker共用一个writer，写入时加锁，记录按完成顺序排列。
+class GVMetricsWriter {
+public:
+    bool open(const string &path);
+    void close();
+    bool isOpen() const { return fout.is_open(); }
+
+    void write(const string &gvName, const UniasAlgo &unias);
+
+private:
+    std::mutex mtx;
+    ofstream fout;
+    bool csv = false;
+    u64_t records = 0;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef UNIAS_INCREMENTAL_H
+#define UNIAS_INCREMENTAL_H
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 增量分析：两次运行之间只有少数bc文件变化时，只重新分析依赖了变化模块的GV，其余GV复用上一次的结果。
+// IncrementalDir中保存上一次运行的状态和结果：
+//   unias-incremental.bin：配置key、各模块的路径和内容hash、符号表（函数/全局变量名及其所在模块）、
+//     结构体的shortcut指纹、每个GV依赖的符号和结构体。
+//   results.jsonl：上一次的完整结果（ResultWriter格式）。
+// GV依赖的符号是它的遍历进入过的节点所在的函数、节点本身对应的全局变量/函数，以及这些节点的邻居中被blackNodes挡住的节点
+// 所在的符号：blackNodes按全程序的边数算出，别的模块增删对这个符号的引用就可能改变它。
+// GV依赖的结构体是进入过的节点在反向GEP边上会查询shortcut/cast site的结构体。这两张表汇集了全程序的GEP和cast，
+// 每个结构体的条目按两端节点所在的符号名和offset算一个指纹（不用NodeID，其他模块变化不影响它）。
+// 以下任一情况GV需要重新分析：
+//   上一次没有它的依赖或结果（包括上一次被预算截断）；
+//   它依赖的某个符号所在的模块内容变化或已删除；
+//   它依赖的某个符号名被内容变化或新增的模块引用（声明或定义），新代码可能经由这个符号连到GV；
+//   它依赖的某个结构体的shortcut指纹变化。
+// 配置key（阈值宏、预算、CallGraph等输入）变化时所有GV都重新分析。blockedCallEdges只由callee名和AllocDenyList决定，
+// 已经包含在配置key里。
+// 没有覆盖的情况：已删除的模块原来对其他符号的引用无从得知，只删除模块、不改其他模块时，
+// 由此改变的blackNodes不会触发重新分析。
+
+#define INCREMENTAL_VERSION 3
+#define NO_MODULE UINT32_MAX
+#define NO_SYMBOL UINT32_MAX
+
+// 64位hash，seed用于分段计算时串联。
+u64_t hashBytes(const void* data, size_t len, u64_t seed = 0);
+
+// 文件内容的hash，读取失败时返回0。
+u64_t hashFileContent(const string &path);
+
+class IncrementalSession {
+public:
+    // 读入dir中上一次的状态，并发计算当前各模块的内容hash并对比。没有可用的上一次状态时所有GV都需要重新分析。
+    void begin(const string &dir, const vector<string> &moduleNames, u64_t configKey, u32_t threadNum);
+
+    // 为当前PAG建立节点到符号的映射，收集变化/新增模块引用的符号名，并计算各结构体的shortcut指纹。
+    // 需要在pagSnapshot建好之后调用。
+    void buildSymbols();
+
+    // 上一次的结果。
+    string previousResultsPath() const { return dir + "/results.jsonl"; }
+    // 本次的结果先写到这里，finish时替换上一次的结果。
+    string pendingResultsPath() const { return dir + "/results.jsonl.tmp"; }
+
+    bool needsRerun(const string &gv) const;
+
+    // 记录重新分析的GV进入过的节点，由此推出它依赖的符号和结构体。多个worker并发调用。
+    void record(const string &gv, const vector<NodeID> &entered);
+    // 被预算截断的GV只有部分结果，不保存依赖（同名的GV一起），下次一定重新分析。多个worker并发调用。
+    void drop(const string &gv);
+    // 复用上一次结果的GV沿用上一次的依赖。需要在worker开始之前调用。
+    void reuse(const string &gv);
+
+    // 写出本次的状态，并用本次的结果替换上一次的结果。
+    bool finish();
+
+private:
+    string dir;
+    u64_t configKey = 0;
+
+    // 上一次的状态。
+    bool hasPrevious = false;
+    vector<string> prevModules;
+    vector<bool> prevModuleDirty;    // 内容变化或已删除。
+    vector<string> prevSymbols;
+    vector<u32_t> prevSymbolModules; // NO_MODULE表示不知道所在模块。
+    unordered_map<string, vector<u32_t>> prevDeps;
+    vector<string> prevStructs;
+    vector<u64_t> prevStructHashes;
+    vector<bool> prevStructDirty;    // shortcut指纹变化，buildSymbols中计算。
+    unordered_map<string, vector<u32_t>> prevStructDeps;
+
+    // 本次的状态。
+    vector<string> modules;
+    unordered_map<string, u32_t> moduleIndex; // 模块路径 -> 下标。
+    vector<u64_t> hashes;
+    vector<bool> moduleChanged;      // 内容变化或新增。
+    unordered_set<string> dirtyNames; // 变化/新增模块里声明或定义的符号名。
+    vector<string> symbols;
+    vector<u32_t> symbolModules;
+    unordered_map<string, u32_t> symbolIds; // 模块下标 + 符号名 -> 符号。
+    vector<u32_t> node2Symbol;              // NodeID -> 符号，NO_SYMBOL表示不属于任何函数/全局变量。
+    std::mutex mtx;
+    unordered_map<string, vector<u32_t>> deps;
+    unordered_set<string> dropped;
+    unordered_map<string, u64_t> structHashes; // 结构体名 -> shortcut指纹，没有shortcut/cast site条目的结构体不在表中。
+    vector<string> depStructs;                  // GV依赖的结构体名。
+    unordered_map<string, u32_t> depStructIds;
+    unordered_map<string, vector<u32_t>> structDeps;
+
+    u32_t internSymbol(const string &name, u32_t module);
+    u32_t internStruct(const string &name);
+    u64_t getStructHash(const string &name) const;
+    void computeStructHashes();
+    bool loadState(const string &path);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef UNIAS_INITCACHE_H
+#define UNIAS_INITCACHE_H
+#include <string>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// initialize()产出的派生表的磁盘缓存。
+// 缓存的是分析阶段真正用到、且只以NodeID/EdgeID/StructID为key的表：
+//   blackNodes、blockedCallEdges、phiIn/phiOut、selectIn/selectOut、structNames、node2StructID、
+//   gepInfos、typebasedShortcuts、additionalShortcuts、castSites。
+// 以LLVM指针为key、只在初始化过程中使用的表（deAnonymousStructs、structType2ID等）不进缓存，命中时它们保持为空。
+// 文件名带有key，输入的bitcode、CallGraph、阈值宏、allocDenyList或格式版本变化时key随之变化，旧文件自然失效。
+
+#define INIT_CACHE_VERSION 1
+
+// 根据输入文件（路径、大小、修改时间）、阈值宏、allocDenyList和格式版本计算缓存key。
+// 只看文件元数据而不读内容，内核规模的bitcode全量hash本身就要很久。
+u64_t computeInitCacheKey(const vector<string> &inputFiles);
+
+string getInitCachePath(const string &dir, u64_t key);
+
+// mmap缓存文件并恢复上述各表。文件不存在、版本/key不符或与当前PAG对不上时返回false，各表保持原状。
+bool loadInitCache(const string &path, u64_t key, SVFIR* pag);
+
+// 把当前各表写入缓存文件（先写临时文件再rename）。失败时只打印提示，不影响分析。
+bool saveInitCache(const string &path, u64_t key, SVFIR* pag);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef UNIAS_INITGRAPH_H
+#define UNIAS_INITGRAPH_H
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// initialize()各阶段读写的表，按位组合。
+enum InitTable : u32_t {
+    IT_NodeEdges      = 1u << 0,  // SVF节点上的各类边集合：getIncomingEdges/getOutgoingEdges在没有该类边时会插入空集合。
+    IT_BlackNodes     = 1u << 1,  // blackNodes、nodeIDBound。
+    IT_BlockedCalls   = 1u << 2,  // blockedCallEdges。
+    IT_PhiEdges       = 1u << 3,  // phiIn、phiOut。
+    IT_SelectEdges    = 1u << 4,  // selectIn、selectOut。
+    IT_AnonStructs    = 1u << 5,  // deAnonymousStructs，getStructName会读。
+    IT_StructNames    = 1u << 6,  // structNames、structName2ID、structType2ID，getStructID会写。
+    IT_Node2StructID  = 1u << 7,  // node2StructID。
+    IT_Shortcuts      = 1u << 8,  // typebasedShortcuts、reverseShortcuts、gepIn。
+    IT_AddShortcuts   = 1u << 9,  // additionalShortcuts。
+    IT_CastSites      = 1u << 10, // castSites。
+    IT_CastMap        = 1u << 11, // castmap。
+    IT_GepInfos       = 1u << 12, // gepInfos。
+};
+
+// initialize()中各setup阶段组成的任务图。每个阶段声明它依赖的阶段，没有依赖关系的阶段可以并发执行。
+// 依赖只能指向先加入的阶段，因此加入顺序本身就是一个合法的串行顺序：单线程时严格按加入顺序执行，
+// 多线程时就绪的阶段也按加入顺序优先调度。
+// 每个阶段还要声明读写的表（InitTable）：add时断言与它冲突的先加入的阶段都是它的（间接）依赖，
+// 多线程执行时再断言同时在跑的阶段之间没有冲突。
+class InitGraph {
+public:
+    typedef u32_t TaskID;
+
+    TaskID add(const string &name, std::function<void()> fn, const vector<TaskID> &deps, u32_t reads, u32_t writes);
+
+    // 执行所有阶段，结束后打印各阶段耗时、总耗时与关键路径。
+    void run(u32_t threadNum);
+
+private:
+    struct Task {
+        string name;
+        std::function<void()> fn;
+        vector<TaskID> deps;
+        vector<TaskID> succs;
+        vector<bool> ancestors; // 按TaskID下标，是否为直接或间接依赖。
+        u32_t reads = 0;
+        u32_t writes = 0;
+        u64_t startUs = 0; // 相对run开始的时间。
+        u64_t endUs = 0;
+    };
+    vector<Task> tasks;
+
+    // 一方写了另一方读或写的表。
+    static bool conflicts(const Task &a, const Task &b){
+        return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+    }
+
+    void execute(Task &task, std::chrono::steady_clock::time_point start);
+    void printStats(u64_t wallUs, u32_t threadNum) const;
+};
+
+// initialize()各阶段的日志：在InitGraph的阶段里时写到该阶段的缓冲，阶段结束后整段输出，并发的阶段不会交错；
+// 不在阶段里时就是errs()。
+raw_ostream &initLog();
+
+#endif
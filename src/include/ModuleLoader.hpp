@@ -0,0 +1,33 @@
+#ifndef UNIAS_MODULELOADER_H
+#define UNIAS_MODULELOADER_H
+#include <string>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 输入bc文件的page cache预读：交给LLVMModuleSet::buildSVFModule之前，用多个线程并发顺序读入，并检查文件头。
+// 这一步不替SVF解析：SVF随后仍在自己的context里串行解析，只是读文件时不再等磁盘，读不到的文件也已经提前剔除。
+// SVF没有接受预先解析好的Module的入口，所以默认不解析。
+// fullParse为true时是诊断模式：每个线程在自己的LLVMContext里完整解析并跑Verifier，报告坏模块和各模块的解析耗时，
+// 代价是每个模块都多解析一次。
+struct ModuleLoadStat {
+    string path;
+    u64_t bytes = 0;
+    u64_t readUs = 0;
+    u64_t parseUs = 0;
+    u64_t verifyUs = 0;
+    bool loadable = false; // 文件可读（fullParse时还要求解析成功），交给SVF加载。
+    bool ok = false;       // loadable，且是bitcode（fullParse时为通过Verifier）。
+    string error;          // 读取、解析或校验失败的原因。
+};
+
+// 结果按moduleNames的顺序返回。
+vector<ModuleLoadStat> prefetchModules(const vector<string> &moduleNames, u32_t threadNum, bool fullParse);
+
+// 打印总耗时、最慢的若干个模块，以及所有失败的模块。
+void printPrefetchStats(const vector<ModuleLoadStat> &stats, u64_t wallUs, u32_t threadNum);
+
+#endif
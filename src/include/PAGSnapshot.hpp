@@ -0,0 +1,97 @@
+#ifndef UNIAS_PAGSNAPSHOT_H
+#define UNIAS_PAGSNAPSHOT_H
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// initialize()之后把PAG连同phi/select、过程间映射冻结成一张只读的CSR图，ComputeAlias只在这上面遍历。
+// 每个节点的邻边按SnapGroup分组连续存放，组的顺序与ComputeAlias处理各类边的顺序一致，
+// 组内顺序与原来遍历SVF边集合/各个unordered_map时的顺序一致，因此遍历结果与直接查PAG时相同。
+enum SnapGroup : u8_t {
+    SG_LoadOut,     // 正向Load边。
+    SG_StoreIn,     // 反向Store边。
+    SG_CopyOut,     // 正向Copy边。
+    SG_SelectOut,   // selectOut，每个(select边, dst)一项。
+    SG_PhiOut,      // phiOut，每个(phi边, dst)一项。
+    SG_Real2Formal, // 实参到形参，edge为nullptr。
+    SG_CallOut,     // 正向Call边，只含callee可进入的（Call/Ret四组同）。
+    SG_Ret2Call,    // 返回值到callsite，edge为nullptr。
+    SG_RetOut,      // 正向Ret边。
+    SG_CopyIn,      // 以下至SG_RetIn是state为true时才处理的反向边。
+    SG_SelectIn,
+    SG_PhiIn,
+    SG_Formal2Real,
+    SG_CallIn,
+    SG_Call2Ret,
+    SG_RetIn,
+    SG_StoreOut,    // 正向Store边（规则1前者边）。
+    SG_LoadIn,      // 反向Load边（规则2、4前者边）。
+    SG_GepIn,       // 反向Gep边。
+    SG_GepOut,      // 正向Gep边。
+    SG_Num
+};
+
+struct SnapEdge {
+    PAGNode* nbr;  // 沿该边到达的节点。
+    PAGEdge* edge; // 对应的PAG边，过程间映射没有边时为nullptr。
+};
+
+class PAGSnapshot {
+public:
+    struct Range {
+        const SnapEdge* first;
+        const SnapEdge* last;
+        const SnapEdge* begin() const { return first; }
+        const SnapEdge* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return last - first; }
+    };
+
+    void build(SVFIR* pag);
+
+    bool isBuilt() const { return !masks.empty(); }
+
+    // 节点有哪些组的邻边，第g位对应SnapGroup g。
+    u32_t getMask(NodeID id) const {
+        return id < masks.size() ? masks[id] : 0;
+    }
+
+    bool has(NodeID id, SnapGroup g) const {
+        return (getMask(id) >> g) & 1;
+    }
+
+    // 节点在某组中的邻边。groupEnds中每个节点占popcount(mask)+1个位置：[行首, 第一个非空组的尾, ...]。
+    Range get(NodeID id, SnapGroup g) const {
+        const u32_t mask = getMask(id);
+        if(!((mask >> g) & 1)){
+            return Range{nullptr, nullptr};
+        }
+        const u32_t k = __builtin_popcount(mask & ((1u << g) - 1));
+        const u32_t* ends = &groupEnds[groupStart[id]];
+        return Range{entries.data() + ends[k], entries.data() + ends[k + 1]};
+    }
+
+    PAGNode* getNode(NodeID id) const {
+        return id < nodes.size() ? nodes[id] : nullptr;
+    }
+
+    NodeID numNodes() const { return nodes.size(); }
+
+    size_t numEntries() const { return entries.size(); }
+
+    size_t memoryBytes() const;
+
+private:
+    vector<PAGNode*> nodes;    // NodeID -> PAGNode*，代替SVFIR::getGNode的map查询。
+    vector<u32_t> masks;       // NodeID -> 非空组的位图。
+    vector<u32_t> groupStart;  // NodeID -> 在groupEnds中的起始位置。
+    vector<u32_t> groupEnds;   // 各节点的行首及各非空组的结束位置（entries下标）。
+    vector<SnapEdge> entries;  // 所有邻边，按节点、组连续存放。
+};
+
+extern PAGSnapshot pagSnapshot;
+
+#endif
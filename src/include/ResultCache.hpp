@@ -0,0 +1,65 @@
+#ifndef UNIAS_RESULTCACHE_H
+#define UNIAS_RESULTCACHE_H
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ResultWriter.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 按遍历过的子图内容寻址的per-GV结果缓存，跨运行、跨内核配置复用。
+// 一个GV的结果只由它进入过的节点决定：每个节点的各组邻边（类型、邻居、是否黑名单）、GEP的字节offset和标记、
+// 能走的shortcut/cast site列表，以及checkIfProtectable读到的Store所在函数。
+// 这些内容hash成节点的签名，进入过的节点按进入顺序的签名再hash成子图指纹。
+// 节点用跨运行稳定的标签（所属函数/全局变量名 + 节点类型 + 在其中的序号）代替NodeID。
+// ResultCacheDir中有两类文件：
+//   unias-rc-gv-<key>.bin：key由GV名和配置算出，记录最近几次分析进入过的节点标签及指纹；
+//   unias-rc-res-<指纹>.bin：该子图的分析结果，内容相同的子图共用一份。
+// 查找时按标签找回当前的节点、重算指纹，与记录一致说明遍历会完全重复上一次，直接取结果。
+// 标签不唯一或找不到的节点都视为不一致，只会少命中，不会用错结果。只缓存没有被截断的结果。
+
+#define RESULT_CACHE_VERSION 1
+#define RESULT_CACHE_WAYS 4 // 每个GV最多记录的子图数，同时分析的几个内核配置各占一个。
+#define NO_LABEL 0
+
+class ResultCache {
+public:
+    bool open(const string &dir, u64_t configKey);
+    bool isOpen() const { return !dir.empty(); }
+
+    // 为当前PAG的所有节点分配标签。需要在pagSnapshot建好之后调用。
+    void buildLabels();
+
+    // 从start开始的gv有可用的缓存结果时返回true，entered为记录中进入过的节点。多个worker并发调用。
+    bool lookup(const string &gv, NodeID start, GVResult &result, vector<NodeID> &entered);
+
+    // 记录一次没有截断的分析，entered为进入过的节点（按进入顺序）。
+    void store(const string &gv, const vector<NodeID> &entered, const GVResult &result);
+
+    void printStats() const;
+
+private:
+    string dir;
+    u64_t configKey = 0;
+    vector<u64_t> labels;                   // NodeID -> 标签，NO_LABEL表示不唯一。
+    unordered_map<u64_t, NodeID> label2Node; // 只含唯一的标签。
+    std::unique_ptr<std::atomic<u64_t>[]> signatures; // NodeID -> 签名，第一次用到时计算。
+
+    std::atomic<u64_t> hits{0};
+    std::atomic<u64_t> misses{0};  // 没有记录。
+    std::atomic<u64_t> stale{0};   // 有记录，但子图已变化。
+    std::atomic<u64_t> stores{0};
+    std::atomic<u64_t> skipped{0}; // 子图含有不唯一的标签，不能缓存。
+
+    u64_t getLabel(NodeID id) const { return id < labels.size() ? labels[id] : NO_LABEL; }
+    u64_t signature(NodeID id);
+    u64_t computeSignature(NodeID id) const;
+    u64_t fingerprint(const vector<NodeID> &entered);
+    string gvPath(const string &gv) const;
+    string resultPath(u64_t fp) const;
+};
+
+#endif
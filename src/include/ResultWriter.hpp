@@ -0,0 +1,101 @@
+#ifndef UNIAS_RESULTWRITER_H
+#define UNIAS_RESULTWRITER_H
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "UniasAlgo.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 一个GV的最终结果：各field是否可保护及其别名数。由worker生成，交给ResultWriter写出。
+struct GVResult {
+    struct Field {
+        s64_t offset;
+        u32_t aliases;
+        bool protectable;
+    };
+    string gv;
+    TruncReason truncated = TruncNone;
+    u64_t timeUs = 0;
+    u64_t steps = 0;
+    vector<Field> fields; // 按offset升序。
+    string record;        // 已经序列化好的记录（增量模式复用上一次的结果），非空时原样写出，忽略上面的字段。
+};
+
+// 索引中的一项。
+struct ResultIndexEntry {
+    string gv; // 已转义。
+    u64_t offset;
+    u32_t length;
+};
+
+// 所有worker共用的结果输出，代替各worker的文本输出文件。
+// worker只把GVResult放进有界队列，序列化和写盘都在单独的writer线程里做；队列满时worker才会等待。
+// 文件格式（JSONL）：
+//   每个GV一行记录，按完成顺序：{"gv":...,"truncated":...,"time_us":...,"steps":...,"offsets":...,
+//     "protectable":...,"alias_nodes":...,"fields":[{"offset":...,"aliases":...,"protect":true|false},...]}
+//   close时追加索引，每个GV一行，按转义后的GV名排序：{"gv":...,"offset":...,"length":...}
+//   最后一行是定长（RESULT_TRAILER_SIZE字节）的尾部：{"index_offset":...,"records":...}，数字左侧用空格补齐。
+// 查找单个GV时先读尾部，再读索引，最后只读对应的记录，见lookupResults。
+#define RESULT_TRAILER_SIZE 61
+
+class ResultWriter {
+public:
+    ~ResultWriter() { close(); }
+
+    bool open(const string &path, size_t queueCap);
+    // 写完队列里剩余的记录，追加索引和尾部，然后结束writer线程。
+    void close();
+    bool isOpen() const { return writer.joinable(); }
+
+    void submit(GVResult &&result);
+
+private:
+    // 以下受mtx保护。
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<GVResult> queue;
+    size_t capacity = 0;
+    bool stopping = false;
+    u64_t maxDepth = 0; // 队列出现过的最大长度。
+    u64_t stalls = 0;   // worker因队列满而等待的次数。
+    u64_t stallUs = 0;
+
+    std::thread writer;
+
+    // 以下只由writer线程访问，close在join之后才读。
+    ofstream fout;
+    u64_t written = 0;
+    vector<ResultIndexEntry> index;
+
+    void writerLoop();
+    void writeIndex();
+};
+
+// 读取ResultWriter生成的文件：open时读入尾部和索引，之后按GV名查找，只读对应的记录。
+class ResultReader {
+public:
+    // 文件不存在或不完整（没有正常close）时返回false。
+    bool open(const string &path);
+
+    // 名为gv的所有记录，按写入顺序（同名的GV、重试阶段都可能让一个名字出现多次）。
+    bool read(const string &gv, vector<string> &records);
+
+    size_t size() const { return index.size(); }
+
+private:
+    ifstream fin;
+    vector<ResultIndexEntry> index; // 按转义后的GV名排序。
+};
+
+// 只查一个GV时的简便写法。
+bool lookupResults(const string &path, const string &gv, vector<string> &records);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef UNIAS_SHORTCUTCACHE_H
+#define UNIAS_SHORTCUTCACHE_H
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "SummaryCache.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 跨GV共享的shortcut展开结果。
+// 反向GEP边走typebased shortcut时，展开的内容是typebased、additional边和cast site，以及它们下面taken为true的整棵子树。
+// 每个(结构体, offset, 栈形状)只展开一次，之后的GV直接把结果按栈底offset拼接进Aliases。
+// 这是近似：子树还取决于展开时的路径，而缓存的结果是在第一个走到这里的GV下算出来的：
+//   - visitedEdges是那个GV当时路径上的边，之后的GV路径不同，原算法里被剪掉的子树也可能不同；
+//   - 不含当时路径上的icall，也不含那个GV的动态黑名单（STAT_THRESHOLD），展开用的是单独的workspace。
+// 与SummaryCache一样，key里去掉栈底，结果中的offset记成相对栈底的差值，并用TraversalSummary::validAt判断深度是否适用。
+
+struct ShortcutKey {
+    StructID stID;
+    s64_t offset;
+    vector<s64_t> stack; // 栈底之上的各元素，编码同SummaryKey。
+
+    bool operator==(const ShortcutKey &other) const {
+        return stID == other.stID && offset == other.offset && stack == other.stack;
+    }
+};
+
+struct ShortcutKeyHash {
+    size_t operator()(const ShortcutKey &key) const {
+        size_t h = std::hash<StructID>()(key.stID) * 2654435761u;
+        h ^= std::hash<s64_t>()(key.offset) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        for (auto item : key.stack) {
+            h ^= std::hash<s64_t>()(item) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+// 按key的hash分片加锁。展开结果不可变，查询时只拷出shared_ptr，拼接在锁外进行。
+// 展开结果的种类不多（结构体 × offset × 栈形状），不做淘汰，内存达到上限后不再插入。
+// 上限对结果和tooLarge标记都生效，按entryBytes的估计值原子地预留，不会被并发插入越过；估计值本身是近似的。
+class ShortcutCache {
+public:
+    ShortcutCache(size_t capBytes, u64_t maxSteps, u32_t shardNum = 64);
+
+    // 命中要求结果在当前深度下仍然有效。tooLarge为true表示这个key之前展开超过了maxSteps，不必再试。
+    shared_ptr<const TraversalSummary> lookup(const ShortcutKey &key, u32_t depth, bool &tooLarge);
+
+    void insert(ShortcutKey &&key, TraversalSummary &&summary);
+    void markTooLarge(ShortcutKey &&key);
+
+    // 单次展开最多进入的节点数，超过时放弃，回到原来逐条边展开的方式。
+    u64_t getMaxSteps() const { return maxSteps; }
+
+    void addSpliced(u64_t n) { splicedAliases += n; }
+    void addExpandUs(u64_t us) { expandUs += us; }
+
+    void printStats() const;
+
+private:
+    struct Entry {
+        shared_ptr<const TraversalSummary> summary; // tooLarge时为空。
+        bool tooLarge = false;
+        size_t bytes = 0;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        unordered_map<ShortcutKey, Entry, ShortcutKeyHash> entries;
+    };
+
+    // 从totalBytes中预留bytes，超出capBytes时不预留并返回false。
+    bool reserve(size_t bytes);
+
+    Shard &getShard(const ShortcutKey &key) {
+        return shards[ShortcutKeyHash()(key) % shards.size()];
+    }
+
+    vector<Shard> shards;
+    size_t capBytes;
+    u64_t maxSteps;
+
+    std::atomic<u64_t> hits;
+    std::atomic<u64_t> misses;
+    std::atomic<u64_t> shallowMisses; // key命中但结果在当前深度下无效。
+    std::atomic<u64_t> inserts;
+    std::atomic<u64_t> tooLargeKeys;
+    std::atomic<u64_t> full;          // 内存达到上限而没有插入（结果或标记）的次数。
+    std::atomic<u64_t> splicedAliases;
+    std::atomic<u64_t> expandUs;      // 未命中时展开所花的时间。
+    std::atomic<size_t> totalBytes;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef UNIAS_SHORTCUTINDEX_H
+#define UNIAS_SHORTCUTINDEX_H
+#include <algorithm>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// setupStores、processCastSites之后把typebasedShortcuts、additionalShortcuts、castSites冻结成只读的扁平索引，
+// ComputeAlias只通过这里的const查询访问shortcuts，多个分析线程可以无锁并发读。
+// 每个(结构体, offset)的边连续存放：先是typebased边，再是additional边。
+// additional边在冻结时按原来的遍历顺序展开、按dst节点去重，并去掉typebased中已经到达的dst节点，
+// 因此遍历顺序和结果与原来在ComputeAlias里边查边去重时相同。
+class ShortcutIndex {
+public:
+    struct Range {
+        PAGEdge* const* first;
+        PAGEdge* const* last;
+        PAGEdge* const* begin() const { return first; }
+        PAGEdge* const* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return last - first; }
+    };
+
+    void build();
+
+    bool isBuilt() const { return !stStart.empty(); }
+
+    // 结构体stID在offset处的Field-to-Field shortcuts。
+    Range typebased(StructID stID, u32_t offset) const {
+        const OffsetEntry* entry = find(stID, offset);
+        return entry ? Range{edges.data() + entry->begin, edges.data() + entry->mid} : Range{nullptr, nullptr};
+    }
+
+    // 结构体stID在offset处的additional shortcuts（已去重，不含typebased能到达的dst节点）。
+    Range additional(StructID stID, u32_t offset) const {
+        const OffsetEntry* entry = find(stID, offset);
+        return entry ? Range{edges.data() + entry->mid, edges.data() + entry->end} : Range{nullptr, nullptr};
+    }
+
+    // 结构体stID的所有cast site（Copy边）。
+    Range castSites(StructID stID) const {
+        if((size_t)stID + 1 >= castStart.size()){
+            return Range{nullptr, nullptr};
+        }
+        return Range{castEdges.data() + castStart[stID], castEdges.data() + castStart[stID + 1]};
+    }
+
+    size_t memoryBytes() const;
+
+private:
+    struct OffsetEntry {
+        u32_t offset;
+        u32_t begin; // typebased边在edges中的区间[begin, mid)。
+        u32_t mid;   // additional边的区间[mid, end)。
+        u32_t end;
+    };
+
+    // 结构体内的offset按升序排列，二分查找。
+    const OffsetEntry* find(StructID stID, u32_t offset) const {
+        if((size_t)stID + 1 >= stStart.size()){
+            return nullptr;
+        }
+        auto first = entries.data() + stStart[stID];
+        auto last = entries.data() + stStart[stID + 1];
+        auto it = std::lower_bound(first, last, offset, [](const OffsetEntry &e, u32_t off){ return e.offset < off; });
+        return it != last && it->offset == offset ? it : nullptr;
+    }
+
+    vector<u32_t> stStart;       // StructID -> 在entries中的起始位置，多一项作为结尾。
+    vector<OffsetEntry> entries;
+    vector<PAGEdge*> edges;      // 所有typebased/additional边。
+    vector<u32_t> castStart;     // StructID -> 在castEdges中的起始位置，多一项作为结尾。
+    vector<PAGEdge*> castEdges;
+};
+
+extern ShortcutIndex shortcutIndex;
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef UNIAS_STACKPOOL_H
+#define UNIAS_STACKPOOL_H
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 哈希共享（hash-consing）的分析栈。每个栈是一个不可变的单链表：栈顶cell记录栈顶元素和它下面那个栈的ID，
+// 内容相同的栈只存一份，因此两个分析栈相同当且仅当StackID相同。
+// 栈元素压缩成一个s64_t（offset * 2 + curFlow，与SummaryKey的编码相同）。
+// 每个worker一份，reset之后开始新的GV，之前的StackID全部失效；哈希表用epoch标记，不用清空。
+typedef u32_t StackID;
+#define EMPTY_STACK_ID 0
+
+class StackPool {
+public:
+    StackPool() { reset(); }
+
+    void reset();
+
+    // 在below之上压入item得到的栈。
+    StackID push(StackID below, s64_t item);
+
+    StackID pop(StackID id) const { return cells[id].below; }
+    s64_t top(StackID id) const { return cells[id].item; }
+
+    size_t size() const { return cells.size(); }
+
+private:
+    struct Cell {
+        s64_t item;
+        StackID below;
+    };
+    struct Slot {
+        u32_t stamp; // 等于epoch时有效。
+        StackID id;
+    };
+
+    vector<Cell> cells; // cells[EMPTY_STACK_ID]是空栈的占位。
+    vector<Slot> slots; // 开放寻址，容量为2的幂。
+    u32_t epoch = 0;
+    size_t used = 0;
+
+    void grow();
+};
+
+#define STATE_TABLE_INIT_SLOTS 1024
+
+// epoch加一，回绕到0时把所有槽位清空。
+template <typename SlotT>
+void nextEpoch(u32_t &epoch, vector<SlotT> &slots){
+    if(++epoch == 0){
+        for(auto &slot : slots){
+            slot.stamp = 0;
+        }
+        epoch = 1;
+    }
+}
+
+// 以u64_t为key的开放寻址表，每项带一个Payload。reset按epoch标记，不用清空，跨GV（或跨批）复用。
+// VisitedStates和BatchAlias的LaneStates都用它记录遍历状态。
+template <typename Payload>
+class EpochStateTable {
+public:
+    EpochStateTable() { reset(); }
+
+    void reset(){
+        if(slots.empty()){
+            slots.resize(STATE_TABLE_INIT_SLOTS, Slot{0, 0, Payload()});
+        }
+        nextEpoch(epoch, slots);
+        used = 0;
+    }
+
+    // key对应的Payload，没有时插入一项值初始化的Payload并置inserted为true。返回的引用在下一次调用前有效。
+    Payload &get(u64_t key, bool &inserted){
+        if((used + 1) * 2 > slots.size()){
+            grow();
+        }
+        const size_t mask = slots.size() - 1;
+        for(size_t i = mix64(key) & mask;; i = (i + 1) & mask){
+            auto &slot = slots[i];
+            if(slot.stamp != epoch){
+                slot = Slot{key, epoch, Payload()};
+                used++;
+                inserted = true;
+                return slot.payload;
+            }
+            if(slot.key == key){
+                inserted = false;
+                return slot.payload;
+            }
+        }
+    }
+
+    Payload &get(u64_t key){
+        bool inserted;
+        return get(key, inserted);
+    }
+
+    size_t size() const { return used; }
+
+private:
+    struct Slot {
+        u64_t key;
+        u32_t stamp; // 等于epoch时有效。
+        Payload payload;
+    };
+
+    vector<Slot> slots; // 容量为2的幂。
+    u32_t epoch = 0;
+    size_t used = 0;
+
+    void grow(){
+        vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.size() * 2, Slot{0, 0, Payload()});
+        const size_t mask = slots.size() - 1;
+        for(auto &slot : old){
+            if(slot.stamp != epoch){
+                continue;
+            }
+            size_t i = mix64(slot.key) & mask;
+            while(slots[i].stamp == epoch){
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+        }
+    }
+};
+
+// 遍历状态(节点, 分析栈, state, taken)的key：节点(32位) | 分析栈(30位) | state | taken。
+// 分析栈ID不小于MAX_STATE_STACK_ID时放不进key，调用方需要先检查。
+#define MAX_STATE_STACK_ID (1u << 30)
+
+inline u64_t packStateKey(NodeID node, StackID stack, bool state, bool taken){
+    return ((u64_t)node << 32) | ((u64_t)stack << 2) | (state ? 2 : 0) | (taken ? 1 : 0);
+}
+
+// 单个GV内已经展开过的遍历状态(节点, 分析栈, state, taken)，以及展开时的路径深度（visitedEdges的大小）。
+// taken决定了子树里能否再走shortcut，所以也是状态的一部分。
+// 同一状态再次出现时，只有路径比上次浅（剩余的MAX_PATH_EDGES预算更多）才需要重新展开。
+// 这是近似：两次到达时路径上的边/icall不同，原算法里被剪掉的子树也可能不同。
+class VisitedStates {
+public:
+    void reset() { table.reset(); }
+
+    // 需要展开时返回true并记下depth，已经在不浅于depth的位置展开过时返回false。
+    bool visit(NodeID node, StackID stack, bool state, bool taken, u32_t depth);
+
+    size_t size() const { return table.size(); }
+
+private:
+    EpochStateTable<u32_t> table; // 状态 -> 展开时的深度。
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef UNIAS_SUMMARYCACHE_H
+#define UNIAS_SUMMARYCACHE_H
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Util.hpp"
+
+using namespace SVF;
+using namespace std;
+
+// 跨GV共享的遍历摘要缓存。
+// 一个摘要描述从某个状态(节点, 分析栈, state, taken)出发，整棵子树最终写进Aliases的所有(offset, 节点)。
+// 分析栈的栈底元素只在栈里只剩它一个时被用来记录Aliases，不参与任何规则匹配，
+// 所以key里去掉栈底，摘要中的offset也都记成相对栈底offset的差值，不同GV到达同一状态时可以直接复用。
+
+struct SummaryKey {
+    NodeID node;
+    bool state;
+    bool taken;
+    vector<s64_t> stack; // 栈底之上的各元素，由底向顶，每个元素编码为 offset * 2 + curFlow。
+
+    bool operator==(const SummaryKey &other) const {
+        return node == other.node && state == other.state && taken == other.taken && stack == other.stack;
+    }
+};
+
+struct SummaryKeyHash {
+    size_t operator()(const SummaryKey &key) const {
+        size_t h = std::hash<NodeID>()(key.node) * 2654435761u;
+        h ^= (key.state ? 0x9e3779b97f4a7c15ull : 0) ^ (key.taken ? 0xc2b2ae3d27d4eb4full : 0);
+        for (auto item : key.stack) {
+            h ^= std::hash<s64_t>()(item) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+struct TraversalSummary {
+    vector<pair<s64_t, PAGNode*>> aliases; // (相对栈底的offset, 别名节点)，已排序去重。
+    u32_t depth;   // 计算摘要时入口处visitedEdges的大小。
+    u32_t span;    // 子树（含拼接进来的摘要）相对入口最多又走了多少条边。
+    bool depthCut; // 子树中有路径因MAX_PATH_EDGES被截断，只能在同样深度下复用。
+
+    // 在入口深度为curDepth的位置复用时，子树的遍历是否与计算时一致。
+    bool validAt(u32_t curDepth) const {
+        if(curDepth == depth){
+            return true;
+        }
+        return !depthCut && (curDepth < depth || curDepth + span <= MAX_PATH_EDGES);
+    }
+};
+
+// 按key的hash分片，每个分片一把锁、一个LRU链表。内存超过上限时从各分片的LRU尾部淘汰。
+// 摘要本身不可变，查询时只拷出shared_ptr，拼接结果在锁外进行。
+class SummaryCache {
+public:
+    SummaryCache(size_t capBytes, u64_t minSteps, NodeID nodeBound, u32_t shardNum = 64);
+
+    // 无锁的粗过滤：该节点上从未插入过摘要时直接跳过查询，省掉构造key和加锁。淘汰时不清除。
+    bool mayContain(NodeID node) const {
+        return node < nodeBound && (nodeBits[node / 64].load(std::memory_order_relaxed) >> (node % 64)) & 1;
+    }
+
+    // 命中要求摘要在当前深度下仍然有效，见TraversalSummary::validAt。
+    shared_ptr<const TraversalSummary> lookup(const SummaryKey &key, u32_t depth);
+
+    void insert(SummaryKey &&key, TraversalSummary &&summary);
+
+    // 子树进入的节点数不足minSteps的不值得缓存，直接重新遍历即可。
+    u64_t getMinSteps() const { return minSteps; }
+
+    void addSpliced(u64_t n) { splicedAliases += n; }
+
+    void printStats() const;
+
+private:
+    struct Entry {
+        shared_ptr<const TraversalSummary> summary;
+        list<const SummaryKey*>::iterator lruIt;
+        size_t bytes;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        unordered_map<SummaryKey, Entry, SummaryKeyHash> entries;
+        list<const SummaryKey*> lru; // 队头是最近使用的。
+        size_t bytes = 0;
+    };
+
+    Shard &getShard(const SummaryKey &key) {
+        return shards[SummaryKeyHash()(key) % shards.size()];
+    }
+
+    static size_t entryBytes(const SummaryKey &key, const TraversalSummary &summary);
+
+    vector<Shard> shards;
+    NodeID nodeBound;
+    unique_ptr<std::atomic<u64_t>[]> nodeBits;
+    size_t shardCap;
+    u64_t minSteps;
+
+    std::atomic<u64_t> hits;
+    std::atomic<u64_t> misses;
+    std::atomic<u64_t> shallowMisses; // key命中但摘要在当前深度下无效。
+    std::atomic<u64_t> inserts;
+    std::atomic<u64_t> evictions;
+    std::atomic<u64_t> splicedAliases;
+    std::atomic<size_t> totalBytes;
+};
+
+#endif
@@ -1,11 +1,18 @@
 #ifndef ALGO_H
 #define ALGO_H
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include "llvm/IR/DataLayout.h"
 
 #include "Util.hpp"
 #include "UtilLLVM.hpp"
+#include "AliasResult.hpp"
+#include "SummaryCache.hpp"
+#include "PAGSnapshot.hpp"
+#include "ShortcutCache.hpp"
+#include "ShortcutIndex.hpp"
+#include "StackPool.hpp"
 
 using namespace SVF;
 using namespace std;
@@ -16,40 +23,283 @@ public:
     // const PAGNode* pagnode;
     s64_t offset; // 用于实现field-sensitive，记录成员偏移。
     bool curFlow; // 目前代码看下来，curFlow的唯一作用就是匹配规则2中的反向store边。
-    PNwithOffset(s64_t os, bool cf) : offset(os), curFlow(cf){//构造函数。
+    PNwithOffset(s64_t os = 0, bool cf = false) : offset(os), curFlow(cf){//构造函数。
 
     }
 };
 
-using typeStack = stack<PNwithOffset>;
+// 在std::stack的基础上暴露底层容器（由底向顶），SummaryCache需要读取整个栈来构造key。
+// 底层用vector：deque在栈深来回越过块边界时会反复分配、释放块。
+class typeStack : public stack<PNwithOffset, vector<PNwithOffset>> {
+public:
+    const container_type &items() const { return c; }
+    void reserve(size_t n) { c.reserve(n); }
+};
+
+// 迭代式ComputeAlias中每一步进入子节点前对分析栈的操作，子节点返回后撤销。
+enum StepOp : u8_t {
+    OpNone,       // 不改动分析栈。
+    OpPop,        // 弹出栈顶（规则1、2配对完成），返回后压回item。
+    OpPush,       // 压入item（Store/Load前者边），返回后弹出。
+    OpOffset,     // 栈顶offset加上delta（GEP边、shortcut），返回后减去。
+    OpSetTaken,   // 伪step：开始走shortcut，置taken。
+    OpClearTaken, // 伪step：shortcut走完，清除taken。
+};
+
+// 递归版中的一次Prop调用：从当前节点沿eg（或过程间的icall）走向nxt。
+struct PropStep {
+    PAGNode* nxt;
+    PAGEdge* eg;
+    PAGNode* icall;
+    bool state;
+    StepOp op;
+    PNwithOffset item; // OpPop: 被弹出栈顶的副本；OpPush: 待压入的元素。
+    s64_t delta;       // OpOffset: 栈顶offset的增量。
+};
+
+// 显式栈中的一帧，对应递归版中的一次ComputeAlias调用。
+struct AliasFrame {
+    static const size_t NO_LOG = (size_t)-1;
+    size_t stepBegin; // 本帧的step在AliasTraversal::steps中的区间[stepBegin, stepEnd)。
+    size_t stepEnd;
+    size_t cursor;    // 下一个待执行的step。
+    bool inChild;     // cursor处的step已经进入子帧，子帧结束后需要propLeave。
+    PAGNode* node;    // 本帧对应的节点和state，帧结束时用来生成摘要。
+    bool state;
+    size_t logBegin;  // 本帧在aliasLog中的起始位置，NO_LOG表示不为本帧生成摘要。
+    u64_t stepsAtEntry;
+    u32_t entryDepth; // 进入本帧时visitedEdges的大小。
+    u32_t maxDepth;   // 本帧子树中到达过的最大visitedEdges大小。
+    u32_t cutFrom;    // 子树被路径上第cutFrom帧及更早进入的边/icall（或动态黑名单）剪过。下标不大于本帧时，结果依赖上下文，不能做摘要。
+    bool depthCut;    // 子树被路径长度上限剪过，摘要只能在同样深度下复用。
+    StackID stackID;  // 进入本帧时分析栈的StackID，只在启用StateDedup时有效。
+};
+
+// 可暂停、可恢复的遍历状态。所有帧的step共用一个vector，子帧的step总是追加在父帧之后。
+struct AliasTraversal {
+    vector<AliasFrame> frames;
+    vector<PropStep> steps;
+    u64_t stepsDone = 0; // 累计进入子节点的次数。
+    vector<pair<s64_t, PAGNode*>> aliasLog; // 启用SummaryCache时，按顺序记录每次写入Aliases的(offset, 节点)。
+    vector<const PAGEdge*> pathEdges;       // 启用SummaryCache时，pathEdges[i]/pathIcalls[i]是进入第i帧时用的eg/icall。
+    vector<const PAGNode*> pathIcalls;
+    bool finished() const { return frames.empty(); }
+};
+
+// 分析单个GV时用到的按NodeID下标的临时状态，以及遍历用的缓冲区。每个worker一份，跨GV复用。
+// 各张表都带epoch标记：表项的stamp等于当前epoch才有效，换GV时只需把epoch加一，不用清空，
+// 缓冲区也保留上一个GV用过的容量，因此稳态下遍历路径上没有堆分配。
+// 同一时刻只能有一个UniasAlgo使用一个workspace：begin会开始新的epoch，之前使用者的状态随之失效。
+class AliasWorkspace {
+public:
+    // 开始分析一个新GV：按节点数扩容，开始新的epoch。
+    void begin(NodeID bound);
+
+    // 当前路径上的icall，代替原来的unordered_set visitedicalls。
+    bool insertIcall(NodeID id) {
+        if(icallStamp[id] == epoch){
+            return false;
+        }
+        icallStamp[id] = epoch;
+        return true;
+    }
+    void eraseIcall(NodeID id) {
+        icallStamp[id] = 0;
+    }
+
+    // 当前GV的动态黑名单，叠加在全局只读的blackNodes之上。
+    bool isDynBlack(NodeID id) const {
+        return dynBlackStamp[id] == epoch;
+    }
+    void addDynBlack(NodeID id) {
+        if(dynBlackStamp[id] != epoch){
+            dynBlackStamp[id] = epoch;
+            dynBlackNum++;
+        }
+    }
+    u32_t numDynBlack() const { return dynBlackNum; }
+
+    // 节点被ComputeAlias访问的次数，代替原来的nodeFreq。resetFreq相当于nodeFreq.clear()。
+    void countVisit(NodeID id) {
+        if(freqStamp[id] != freqEpoch){
+            freqStamp[id] = freqEpoch;
+            freq[id] = 0;
+            touched.push_back(id);
+        }
+        freq[id]++;
+    }
+    void resetFreq();
+
+    // 节点上一次写入Aliases时的offset。同一节点大多反复以同一offset被记录，这里先挡掉，不必再查AliasResult。
+    bool newAlias(NodeID id, s64_t offset) {
+        if(aliasStamp[id] == epoch && aliasOffset[id] == offset){
+            return false;
+        }
+        aliasStamp[id] = epoch;
+        aliasOffset[id] = offset;
+        return true;
+    }
+
+    // 当前GV进入过的节点，只在UniasAlgo::trackEntered时记录，增量模式据此推出GV依赖的函数和全局变量。
+    void markEntered(NodeID id) {
+        if(enteredStamp[id] != epoch){
+            enteredStamp[id] = epoch;
+            enteredNodes.push_back(id);
+        }
+    }
+    const vector<NodeID>& getEntered() const { return enteredNodes; }
+
+    // 访问次数最多的k个节点，次数相同时先访问到的在前。
+    void topFrequent(size_t k, vector<NodeID> &out);
+
+    // 与UniasAlgo::traversal交换缓冲区：开始遍历时借出（并清空），遍历结束后还回。
+    void swapBuffers(AliasTraversal &traversal);
+
+    // 启用StateDedup时的哈希共享分析栈和已展开状态表，begin时一并重置。
+    StackPool stacks;
+    VisitedStates states;
+
+private:
+    u32_t epoch = 0;
+    u32_t freqEpoch = 0;
+    u32_t dynBlackNum = 0;
+    vector<u32_t> icallStamp;    // NodeID -> epoch
+    vector<u32_t> dynBlackStamp; // NodeID -> epoch
+    vector<u32_t> freqStamp;     // NodeID -> freqEpoch
+    vector<u32_t> freq;          // NodeID -> 访问次数。计数在超过STAT_THRESHOLD后清零，u32_t足够。
+    vector<u32_t> aliasStamp;    // NodeID -> epoch
+    vector<s64_t> aliasOffset;   // NodeID -> 上一次记录的offset
+    vector<u32_t> enteredStamp;  // NodeID -> epoch
+    vector<NodeID> enteredNodes; // 当前epoch中进入过的节点，按首次进入的顺序。
+    vector<NodeID> touched;      // 当前freqEpoch中访问过的节点，按首次访问的顺序。
+    vector<pair<u32_t, NodeID>> sorted;
+    AliasTraversal buffers;
+};
+
+// 当前路径上的边，代替unordered_set visitedEdges。propEnter在插入前检查路径长度，
+// 所以最多MAX_PATH_EDGES + 1条，定长数组线性查找即可，不分配内存。插入和删除总是后进先出。
+class PathEdgeSet {
+public:
+    size_t size() const { return num; }
+    bool empty() const { return num == 0; }
+    bool insert(const PAGEdge* edge) {
+        for(u32_t i = 0; i < num; i++){
+            if(items[i] == edge){
+                return false;
+            }
+        }
+        assert(num < CAPACITY && "PathEdgeSet: path longer than MAX_PATH_EDGES + 1");
+        items[num++] = edge;
+        return true;
+    }
+    void erase(const PAGEdge* edge) {
+        for(u32_t i = num; i-- > 0;){
+            if(items[i] == edge){
+                items[i] = items[--num];
+                return;
+            }
+        }
+    }
+    void clear() { num = 0; }
+
+private:
+    static const u32_t CAPACITY = MAX_PATH_EDGES + 1;
+    const PAGEdge* items[CAPACITY];
+    u32_t num = 0;
+};
+
+// 单个GV的分析预算，0表示不限。
+struct AliasBudget {
+    u64_t timeUs = 0; // 墙钟时间（微秒）。
+    u64_t steps = 0;  // 进入子节点的次数，即AliasTraversal::stepsDone。
+    bool unlimited() const { return !timeUs && !steps; }
+};
+
+// 预算耗尽时遍历被提前结束的原因。
+enum TruncReason : u8_t {
+    TruncNone,  // 遍历完整结束。
+    TruncTime,  // 超出时间预算。
+    TruncSteps, // 超出步数预算。
+};
+
+const char* truncReasonName(TruncReason reason);
+
+#define BUDGET_CHECK_STEPS 4096 // 有预算时，每resume这么多步检查一次时间。
+
+// 单个GV分析过程中的热路径统计，每项只是一次自增，始终开启。
+struct AliasMetrics {
+    u64_t calls = 0;              // ComputeAlias（enterNode）调用次数。与counter不同，不随动态黑名单触发清零。
+    u64_t rejectBlack = 0;        // Prop被静态blackNodes拒绝。
+    u64_t rejectDynBlack = 0;     // Prop被动态黑名单拒绝。
+    u64_t rejectEdgeCap = 0;      // 路径上的边数超过MAX_PATH_EDGES。
+    u64_t rejectEdge = 0;         // 边已在当前路径上。
+    u64_t rejectIcall = 0;        // icall已在当前路径上。
+    u64_t rejectState = 0;        // 同一状态已在不浅于当前的深度展开过（StateDedup）。
+    u64_t typebasedShortcuts = 0; // 展开的各类shortcut边数。
+    u64_t additionalShortcuts = 0;
+    u64_t castSiteShortcuts = 0;
+    u64_t dynBlackTriggers = 0;   // 动态黑名单（STAT_THRESHOLD）触发次数。
+    u32_t maxStackDepth = 0;      // AnalysisStack的峰值深度。
+};
 
 // 每分析一个GV，就构建一个UniasAlgo实例。
 class UniasAlgo{
 public:
-    unordered_set<PAGEdge*> visitedEdges; // 用于在Prop函数中进行traversal控制。
+    PathEdgeSet visitedEdges; // 用于在Prop函数中进行traversal控制。
     typeStack AnalysisStack;      // 元素为PNwithOffset的Stack，初始包含一个(os=0, cf=false)的元素。维护当前分析状态。
                                   // 只有规则1、2、4中Load/Store边的处理逻辑会对分析栈pop/push，GEP边的处理逻辑则会对栈顶元素offset操作。
                                   // 栈中只有一个元素说明Load/Store边全都规约掉了，栈顶元素的offset为0说明GEP边全部规约掉了。
-    map<s64_t, unordered_set<PAGNode*>> Aliases; // 记录当前GV的各个fields的别名节点集合。
+    AliasResult Aliases; // 记录当前GV的各个fields的别名节点集合（offset -> NodeID），ComputeAliasWithin结束后才能读取。
     SVFIR *pag;
     bool taken = false; // 记录当前ComputeAlias的分析是否采用了TypebasedShortcut。当前分析layer的递归调用层是不能再采用shortcuts的。（shortcutTaken）
     PAGNode* taskNode;  // 当前分析的起始GV节点，初始设定一个GV之后不再修改。
     DataLayout* DL;     // 当前GV所在bitcode文件的layout，可用于计算type的大小。（Added by LHY）
-    unordered_set<NodeID> blackNodes;
-    unordered_set<PAGNode*> visitedicalls;
-    unordered_map<PAGNode*, u64_t> nodeFreq; // 记录每个PAGNode被ComputeAlias访问的次数。
+    // 当前路径上的icall、动态黑名单和各节点的访问次数都在workspace里。每个worker一份，跨GV复用；
+    // 为空时startAlias为这个实例单独创建一份。
+    AliasWorkspace* workspace = nullptr;
     int counter = 0;    // 记录分析当前GV的过程中，ComputeAlias调用的总次数。
     int breakpoint = 3;
-    
-    bool ifValidForTypebasedShortcut(PAGEdge* edge, u32_t threshold);
+    AliasTraversal traversal; // 显式栈，代替ComputeAlias/Prop的递归。
+    SummaryCache* summaries = nullptr; // 跨GV共享的遍历摘要，为空表示不启用。
+    ShortcutCache* shortcuts = nullptr; // 跨GV共享的shortcut展开结果，为空表示不启用。
+    bool dedupStates = false;          // 同一GV内(节点, 分析栈, state, taken)状态去重，见VisitedStates。
+    bool trackEntered = false;         // 在workspace中记录进入过的节点，见AliasWorkspace::markEntered。
+    TruncReason truncated = TruncNone; // ComputeAliasWithin因预算耗尽提前结束时的原因，此时Aliases只是到目前为止的部分结果。
+    u64_t analysisUs = 0;              // ComputeAliasWithin实际花费的时间。
+    AliasMetrics metrics;
 
-    bool ifValidForCastSiteShortcut(PAGEdge* edge, u32_t threshold);
+    // 从cur开始一次完整的遍历（startAlias + resumeAlias直到结束）。
+    void ComputeAlias(PAGNode* cur, bool state);
 
-    void Prop(PAGNode* nxt, PAGEdge* eg, bool state, PAGNode* icall);
+    // 可暂停的遍历接口：resumeAlias最多进入maxSteps个子节点，遍历结束时返回true。
+    void startAlias(PAGNode* cur, bool state);
+    bool resumeAlias(u64_t maxSteps);
 
-    void ComputeAlias(PAGNode* cur, bool state);
+    // 在预算内执行ComputeAlias：按BUDGET_CHECK_STEPS分片resume，预算耗尽时停止并设置truncated。
+    // 预算不限时与ComputeAlias完全相同。遍历完整结束返回true。
+    bool ComputeAliasWithin(PAGNode* cur, bool state, const AliasBudget &budget);
 
     void postProcessGV();
+
+private:
+    void enterNode(PAGNode* cur, bool state);
+    void addStep(PAGNode* nxt, PAGEdge* eg, bool state, PAGNode* icall,
+                 StepOp op = OpNone, PNwithOffset item = PNwithOffset(), s64_t delta = 0);
+    bool propEnter(const PropStep &step);
+    void propLeave(const PropStep &step);
+    void recordAlias(s64_t offset, PAGNode* node);
+    void makeSummaryKey(PAGNode* node, bool state, SummaryKey &key) const;
+    bool spliceSummary(PAGNode* node, bool state);
+    void saveSummary(const AliasFrame &frame);
+    void markContextCut(const PAGEdge* eg, const PAGNode* icall);
+    bool addShortcutSteps(const GepInfo* info);
+    void startShortcut(const GepInfo* info);
+    bool expandShortcut(const GepInfo* info, TraversalSummary &summary) const;
+    bool spliceShortcut(const GepInfo* info, AliasFrame &frame);
+    StackID topStackID(StackID below) const;
+
+    std::unique_ptr<AliasWorkspace> ownWorkspace;
+    StackID stackID = EMPTY_STACK_ID; // 当前分析栈在workspace->stacks中的ID，只在启用StateDedup时维护。
 };
 
 #endif
\ No newline at end of file
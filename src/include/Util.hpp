@@ -20,12 +20,15 @@
 #endif
 
 #define STAT_THRESHOLD 500000
+#define MAX_PATH_EDGES 25 // 一条分析路径上visitedEdges的上限，超过后不再往下Prop。
 
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include "SVF-LLVM/SVFIRBuilder.h"
 #include "SVF-LLVM/LLVMUtil.h"
+#include "llvm/ADT/BitVector.h"
 
 using namespace SVF;
 using namespace llvm;
@@ -33,12 +36,40 @@ using namespace std;
 
 // extern llvm::cl::opt<std::string> SpecifyInput;
 
+// 64位整数的混合函数（MurmurHash3的fmix64），开放寻址表和内容hash共用。
+inline u64_t mix64(u64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
 extern unordered_set<string> NewInitFuncstr;
 
+// 不进入的callee名。目前没有地方填充，保持为空；getBlackNodes拉黑的是高扇入callsite上的节点，与这里无关。
 extern unordered_set<string> blackCalls;
 extern unordered_set<string> blackRets;
 
-extern unordered_set<NodeID> blackNodes;
+// 全局黑名单节点：getBlackNodes结束后即冻结，按NodeID下标的只读bitset，各分析线程共享。
+// 分析过程中的动态黑名单放在每个UniasAlgo的workspace里（见AliasWorkspace）。
+extern BitVector blackNodes;
+extern NodeID nodeIDBound; // PAG中最大NodeID+1，dense表都按它分配。
+
+inline bool isBlackNode(NodeID id) {
+    return id < blackNodes.size() && blackNodes.test(id);
+}
+
+// Call/Ret边能否进入：setupCallAdmissibility中按callee名一次性算好，按EdgeID下标的只读bitset。
+// callee在blackCalls/blackRets中，或名字含有allocDenyList中的子串（默认kmalloc、kzalloc、kcalloc）时置位。
+extern vector<string> allocDenyList;
+extern BitVector blockedCallEdges;
+
+inline bool isBlockedCallEdge(const PAGEdge* edge) {
+    const EdgeID id = edge->getEdgeID();
+    return id < blockedCallEdges.size() && blockedCallEdges.test(id);
+}
 
 extern unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> phiIn;
 extern unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> phiOut;
@@ -48,14 +79,45 @@ extern unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> sel
 
 // extern unordered_map<const SVFType*, unordered_set<const SVFFunction*>> type2funcs;
 
-extern unordered_map<string, unordered_map<u32_t, unordered_set<PAGEdge*>>> typebasedShortcuts;
-extern unordered_map<string, unordered_map<u32_t, unordered_set<unordered_set<PAGEdge*>*>>> additionalShortcuts;
-extern unordered_map<string, unordered_set<PAGEdge*>> castSites;
-extern unordered_map<PAGEdge*, unordered_map<u32_t, unordered_set<string>>> reverseShortcuts;
+// 结构体类型的dense ID：handleAnonymousStruct之后按getStructName的结果分配，同名的StructType共享一个ID。
+typedef u32_t StructID;
+#define EMPTY_STRUCT_ID 0                // getStructName返回""的结构体。
+#define INVALID_STRUCT_ID ((StructID)-1) // 不指向结构体。
+
+extern vector<string> structNames; // StructID -> 结构体名。
+extern unordered_map<const StructType*, StructID> structType2ID;
+extern vector<StructID> node2StructID; // NodeID -> 节点类型所指向结构体的ID，代替热路径上的ifPointToStruct(SVFType*)。
+
+inline StructID getNodeStructID(NodeID id) {
+    return id < node2StructID.size() ? node2StructID[id] : INVALID_STRUCT_ID;
+}
+
+extern unordered_map<StructID, unordered_map<u32_t, unordered_set<PAGEdge*>>> typebasedShortcuts;
+extern unordered_map<StructID, unordered_map<u32_t, unordered_set<unordered_set<PAGEdge*>*>>> additionalShortcuts;
+extern unordered_map<StructID, unordered_set<PAGEdge*>> castSites;
+extern unordered_map<PAGEdge*, unordered_map<u32_t, unordered_set<StructID>>> reverseShortcuts;
 extern unordered_map<PAGNode*, PAGEdge*> gepIn;
 
-extern unordered_map<const PAGEdge*, long> gep2byteoffset;
-extern unordered_set<const PAGEdge*> variantGep;
+// GEP边的dense信息表，按EdgeID下标，代替原来的gep2byteoffset/variantGep。
+// collectByteoffset写入offset和GEP_HAS_OFFSET/GEP_VARIANT，finalizeGepInfos在shortcuts表建好后补上结构体ID和shortcut资格位。
+#define GEP_HAS_OFFSET   0x1 // 常量offset（字节数），offset字段有效。
+#define GEP_VARIANT      0x2 // offset为non-constant，回退到field不敏感的分析。优先于GEP_HAS_OFFSET。
+#define GEP_TYPEBASED_SC 0x4 // 源结构体和offset能在typebasedShortcuts中匹配到，且规模小于SC_THRESHOLD * 5。
+#define GEP_CASTSITE_SC  0x8 // 源结构体的castSites规模小于SC_THRESHOLD（没有cast site时也算）。
+
+struct GepInfo {
+    long offset;
+    StructID stID; // 源节点类型所指向结构体的ID。
+    u32_t flags;
+};
+
+extern vector<GepInfo> gepInfos;
+
+// 不是GEP边或没有记录时返回nullptr。
+inline const GepInfo* getGepInfo(const PAGEdge* edge) {
+    const EdgeID id = edge->getEdgeID();
+    return id < gepInfos.size() && gepInfos[id].flags ? &gepInfos[id] : nullptr;
+}
 
 extern unordered_map<const Value*, const Module*> value2Module;
 
@@ -75,15 +137,24 @@ void readCallGraph(string filename, SVFModule* mod, SVFIR* pag);
 
 void setupCallGraph(SVFIR* _pag);
 
+NodeID getNodeIDBound(SVFIR* pag);
+
 void getBlackNodes(SVFIR* pag);
 
+void loadAllocDenyList(string filename);
+
+void setupCallAdmissibility(SVFIR* pag);
+
 void setupPhiEdges(SVFIR* pag);
 
 void setupSelectEdges(SVFIR* pag);
 
 void handleAnonymousStruct(SVFModule* svfModule, SVFIR* pag);
 
-void collectByteoffset(SVFIR* pag);
+void setupStructIDs(SVFIR* pag);
+
+// threadNum>1时按module分片并行，结果与串行一致。
+void collectByteoffset(SVFIR* pag, u32_t threadNum = 1);
 
 void setupStores(SVFIR* pag);
 
@@ -91,14 +162,25 @@ void processCastSites(SVFIR* pag);
 
 void processCastMap(SVFIR* pag);
 
+void finalizeGepInfos(SVFIR* pag);
+
 // 
 // Unias specific.
 // 
 void processArguments(int argc, char **argv, int &arg_num, char **arg_value,
                                 std::vector<std::string> &moduleNameVec);
 
+bool isInitFunction(const Function* func);
+const Function* getStoreFunction(const PAGEdge* store);
 bool checkIfProtectable(PAGNode* pagnode);
 
+// checkIfProtectable的预计算结果：setupProtectability之后按NodeID下标的只读bitset，置位表示节点有init函数之外的Store，
+// 各分析线程共享。需要在读入NewInitFuncstr之后建立；建立之前checkIfProtectable仍逐条Store边判断。
+extern BitVector nonInitStoreNodes;
+extern bool nonInitStoreReady;
+
+void setupProtectability(SVFIR* pag, u32_t threadNum = 1);
+
 // KallGraph related.
 bool checkIfAddrTaken(SVFIR* pag, PAGNode* node);
 void addSVFAddrFuncs(SVFModule* svfModule, SVFIR* pag);
@@ -109,6 +191,84 @@ bool checkIfMatch(const CallInst* callinst, const Function* callee);
 // 
 void sortMap(std::vector<pair<PAGNode*, u64_t>> &sorted, unordered_map<PAGNode*, u64_t> &before, int k);
 
+u64_t getCurrentRSSKB();
+
+string jsonEscape(const string &str);
+
+// 二进制缓存/状态文件（InitCache、增量状态、ResultCache）的顺序写入。字符串编码为u32_t长度加内容。
+class BinaryWriter {
+public:
+    string buf;
+
+    template <typename T>
+    void put(const T &val){
+        buf.append(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    void putBytes(const void* data, size_t len){
+        buf.append(static_cast<const char*>(data), len);
+    }
+
+    void putString(const string &str){
+        put((u32_t)str.size());
+        buf.append(str);
+    }
+};
+
+// 在一段只读内存上顺序读取，越界时置ok为false并一直返回0。
+class BinaryReader {
+public:
+    BinaryReader(const char* begin, const char* end) : cur(begin), end(end) {}
+    BinaryReader(const string &buf) : BinaryReader(buf.data(), buf.data() + buf.size()) {}
+
+    bool ok = true;
+
+    template <typename T>
+    T get(){
+        T val;
+        if(!take(&val, sizeof(T))){
+            memset(&val, 0, sizeof(T));
+        }
+        return val;
+    }
+
+    bool take(void* dst, size_t len){
+        if(!ok || (size_t)(end - cur) < len){
+            ok = false;
+            return false;
+        }
+        memcpy(dst, cur, len);
+        cur += len;
+        return true;
+    }
+
+    string getString(){
+        u32_t len = get<u32_t>();
+        if(!ok || (size_t)(end - cur) < len){
+            ok = false;
+            return string();
+        }
+        string str(cur, len);
+        cur += len;
+        return str;
+    }
+
+    // 前面都读取成功，且接下来是文件尾标记endMarker（防止读到写了一半的文件）。
+    bool atEnd(u64_t endMarker){
+        return ok && get<u64_t>() == endMarker && ok;
+    }
+
+private:
+    const char* cur;
+    const char* end;
+};
+
+// 先写到临时文件再rename，并发的线程和同时运行的其他进程都只会读到完整的文件。失败时不留下临时文件。
+bool writeFileAtomically(const string &path, const string &buf);
+
+// 读入整个文件，打不开时返回false。
+bool readWholeFile(const string &path, string &buf);
+
 bool pairCompare(const std::pair<s64_t, std::string>& a, const std::pair<s64_t, std::string>& b);
 
 bool checkTwoTypes(Type* src, Type* dst, unordered_map<const Type*, unordered_set<const Type*>> &castmap);
@@ -121,6 +281,8 @@ void getSrcNodes(PAGNode* node, unordered_set<PAGNode*> &visitedNodes);
 
 string getStructName(StructType* sttype);
 
+StructID getStructID(StructType* sttype);
+
 StructType* gotStructSrc(PAGNode* node, unordered_set<PAGNode*> &visitedNodes);
 
 #endif
\ No newline at end of file
@@ -35,6 +35,9 @@ const llvm::Instruction* getLLVMInstruction(const SVFInstruction* inst);
 
 const llvm::CallInst* getLLVMCallInst(const SVFCallInst *inst);
 
+// 节点所在的函数，或者节点本身对应的全局变量/函数。都没有时返回nullptr。
+const llvm::GlobalValue* getNodeOwner(const PAGNode* node);
+
 // 
 // Raw LLVM IR analysis.
 // 
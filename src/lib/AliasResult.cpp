@@ -0,0 +1,77 @@
+#include "../include/AliasResult.hpp"
+#include <algorithm>
+
+// 缓冲区至少积累这么多项才整理一次，避免小集合频繁排序。
+#define ALIAS_COMPACT_MIN 16
+
+void AliasResult::compact(Entry &entry){
+    std::sort(entry.nodes.begin(), entry.nodes.end());
+    entry.nodes.erase(std::unique(entry.nodes.begin(), entry.nodes.end()), entry.nodes.end());
+    entry.compacted = entry.nodes.size();
+}
+
+void AliasResult::insert(s64_t offset, NodeID node){
+    finalized = false;
+    if(lastHit >= entries.size() || entries[lastHit].offset != offset){
+        auto it = std::lower_bound(entries.begin(), entries.end(), offset,
+                                   [](const Entry &e, s64_t off){ return e.offset < off; });
+        if(it == entries.end() || it->offset != offset){
+            it = entries.insert(it, Entry{offset, {}, 0});
+        }
+        lastHit = it - entries.begin();
+    }
+    auto &entry = entries[lastHit];
+    // 同一节点会被反复记录：先查有序前缀，已有的就不再追加。
+    if(!entry.nodes.empty() && entry.nodes.back() == node){
+        return;
+    }
+    if(std::binary_search(entry.nodes.begin(), entry.nodes.begin() + entry.compacted, node)){
+        return;
+    }
+    entry.nodes.push_back(node);
+    if(entry.nodes.size() >= 2 * std::max<size_t>(entry.compacted, ALIAS_COMPACT_MIN)){
+        compact(entry);
+    }
+}
+
+void AliasResult::finalize(){
+    if(finalized){
+        return;
+    }
+    for(auto &entry : entries){
+        if(entry.compacted != entry.nodes.size()){
+            compact(entry);
+        }
+        entry.nodes.shrink_to_fit();
+    }
+    finalized = true;
+}
+
+void AliasResult::clear(){
+    entries.clear();
+    lastHit = 0;
+    finalized = true;
+}
+
+const AliasResult::Entry* AliasResult::find(s64_t offset) const{
+    assert(finalized);
+    auto it = std::lower_bound(entries.begin(), entries.end(), offset,
+                               [](const Entry &e, s64_t off){ return e.offset < off; });
+    return it != entries.end() && it->offset == offset ? &*it : nullptr;
+}
+
+u64_t AliasResult::totalNodes() const{
+    u64_t num = 0;
+    for(auto &entry : entries){
+        num += entry.nodes.size();
+    }
+    return num;
+}
+
+size_t AliasResult::memoryBytes() const{
+    size_t bytes = entries.capacity() * sizeof(Entry);
+    for(auto &entry : entries){
+        bytes += entry.nodes.capacity() * sizeof(NodeID);
+    }
+    return bytes;
+}
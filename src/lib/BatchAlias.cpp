@@ -0,0 +1,233 @@
+#include "../include/BatchAlias.hpp"
+#include <algorithm>
+#include <chrono>
+
+// 栈元素的编码与StackPool相同：offset * 2 + curFlow。
+static inline s64_t itemOffset(s64_t item){
+    return item >> 1;
+}
+
+static inline bool itemCurFlow(s64_t item){
+    return item & 1;
+}
+
+static inline s64_t packItem(s64_t offset, bool curFlow){
+    return offset * 2 + (curFlow ? 1 : 0);
+}
+
+// 栈顶offset加上delta得到的栈，对应per-GV引擎的OpOffset。
+StackID BatchAlias::offsetTop(StackID stack, s64_t delta){
+    const s64_t top = stacks.top(stack);
+    return stacks.push(stacks.pop(stack), packItem(itemOffset(top) + delta, itemCurFlow(top)));
+}
+
+// 把lanes并入下一层的状态，只有之前没到达过该状态的lane才需要展开。
+void BatchAlias::enqueue(NodeID node, StackID stack, bool state, bool taken, LaneMask lanes){
+    auto &slot = seen.get(packStateKey(node, stack, state, taken));
+    const LaneMask fresh = lanes & ~slot.lanes;
+    if(!fresh){
+        return;
+    }
+    slot.lanes |= fresh;
+    if(slot.nextLevel == level + 1){
+        next[slot.nextPos].lanes |= fresh;
+        metrics.merged++;
+        return;
+    }
+    slot.nextLevel = level + 1;
+    slot.nextPos = next.size();
+    next.push_back(Item{node, stack, state, taken, fresh});
+}
+
+// 对应per-GV引擎的propEnter：这里只剩静态黑名单，路径上的边/icall不再检查。
+void BatchAlias::addNext(NodeID nxt, StackID stack, bool state, bool taken, LaneMask lanes){
+    metrics.edges++;
+    if(isBlackNode(nxt)){
+        metrics.rejectBlack++;
+        return;
+    }
+    if(stack >= MAX_STATE_STACK_ID){
+        metrics.overflow++;
+        return;
+    }
+    enqueue(nxt, stack, state, taken, lanes);
+}
+
+// 对应per-GV引擎的enterNode：记录Alias，然后按同样的边处理顺序和规则生成后继，分析栈的操作对整组lane只做一次。
+// 第level层的节点路径深度为level - 1，与propEnter一样，深度超过MAX_PATH_EDGES的节点不再往下走。
+void BatchAlias::expand(const Item &item){
+    metrics.states++;
+    metrics.laneSteps += __builtin_popcountll(item.lanes);
+    const NodeID curID = item.node;
+    const StackID stack = item.stack;
+    const bool state = item.state;
+    const bool taken = item.taken;
+    const bool single = stacks.pop(stack) == EMPTY_STACK_ID;
+    const s64_t topItem = stacks.top(stack);
+    const s64_t topOffset = itemOffset(topItem);
+    if(single){
+        for(LaneMask m = item.lanes; m; m &= m - 1){
+            Aliases[__builtin_ctzll(m)].insert(topOffset, curID);
+        }
+    }
+    if(level - 1 > MAX_PATH_EDGES){
+        return;
+    }
+    const u32_t mask = pagSnapshot.getMask(curID);
+    if(mask == 0){
+        return;
+    }
+    auto has = [mask](SnapGroup g){ return (mask >> g) & 1; };
+    const LaneMask lanes = item.lanes;
+
+    // 正向Load边（规则1、4，后者边）。
+    if(has(SG_LoadOut) && !single && topOffset == 0){
+        const StackID popped = stacks.pop(stack);
+        for(auto &se : pagSnapshot.get(curID, SG_LoadOut)){
+            addNext(se.nbr->getId(), popped, false, taken, lanes);
+        }
+    }
+    // 反向Store边（规则2，后者边）。
+    if(has(SG_StoreIn) && !single && itemCurFlow(topItem) && topOffset == 0){
+        const StackID popped = stacks.pop(stack);
+        for(auto &se : pagSnapshot.get(curID, SG_StoreIn)){
+            addNext(se.nbr->getId(), popped, true, taken, lanes);
+        }
+    }
+    // 正向Assign边和过程间边，不改动分析栈。
+    for(auto g : {SG_CopyOut, SG_SelectOut, SG_PhiOut, SG_Real2Formal, SG_CallOut, SG_Ret2Call, SG_RetOut}){
+        if(has(g)){
+            for(auto &se : pagSnapshot.get(curID, g)){
+                addNext(se.nbr->getId(), stack, false, taken, lanes);
+            }
+        }
+    }
+    // 反向Assign边和过程间边。
+    if(state){
+        for(auto g : {SG_CopyIn, SG_SelectIn, SG_PhiIn, SG_Formal2Real, SG_CallIn, SG_Call2Ret, SG_RetIn}){
+            if(has(g)){
+                for(auto &se : pagSnapshot.get(curID, g)){
+                    addNext(se.nbr->getId(), stack, true, taken, lanes);
+                }
+            }
+        }
+    }
+    // 正向Store边（规则1，前者边）。
+    if(has(SG_StoreOut)){
+        const StackID pushed = stacks.push(stack, packItem(0, false));
+        for(auto &se : pagSnapshot.get(curID, SG_StoreOut)){
+            addNext(se.nbr->getId(), pushed, true, taken, lanes);
+        }
+    }
+    // 反向Load边（规则2、4，前者边）。
+    if(state && has(SG_LoadIn)){
+        const StackID pushed = stacks.push(stack, packItem(0, true));
+        for(auto &se : pagSnapshot.get(curID, SG_LoadIn)){
+            addNext(se.nbr->getId(), pushed, true, taken, lanes);
+        }
+    }
+    // 反向Gep边及Shortcuts，规则与UniasAlgo::enterNode相同，shortcut到达的状态taken为true。
+    if(state && has(SG_GepIn)){
+        for(auto &se : pagSnapshot.get(curID, SG_GepIn)){
+            const GepInfo* info = getGepInfo(se.edge);
+            if(!info){
+                continue;
+            }
+            if(info->flags & GEP_VARIANT){
+                addNext(se.nbr->getId(), stack, true, taken, lanes);
+                continue;
+            }
+            if(!(info->flags & GEP_HAS_OFFSET)){
+                continue;
+            }
+            const auto offset = info->offset;
+            bool castShortcutTaken = false;
+            if(!taken && (info->flags & GEP_TYPEBASED_SC)){
+                const auto stID = info->stID;
+                for(auto range : {shortcutIndex.typebased(stID, offset), shortcutIndex.additional(stID, offset)}){
+                    for(auto dstShort : range){
+                        addNext(dstShort->getDstID(), stack, false, true, lanes);
+                    }
+                }
+                if(info->flags & GEP_CASTSITE_SC){
+                    const StackID shifted = offsetTop(stack, -offset);
+                    for(auto dstCast : shortcutIndex.castSites(stID)){
+                        const bool srcSame = getNodeStructID(dstCast->getSrcID()) == stID;
+                        const bool dstSame = getNodeStructID(dstCast->getDstID()) == stID;
+                        if(!srcSame || dstSame){
+                            addNext(dstCast->getSrcID(), shifted, true, true, lanes);
+                        }
+                        if(srcSame || !dstSame){
+                            addNext(dstCast->getDstID(), shifted, false, true, lanes);
+                        }
+                    }
+                    castShortcutTaken = true;
+                }
+            }
+            if(!castShortcutTaken){
+                addNext(se.nbr->getId(), offsetTop(stack, -offset), true, taken, lanes);
+            }
+        }
+    }
+    // 正向Gep边。
+    if(has(SG_GepOut)){
+        for(auto &se : pagSnapshot.get(curID, SG_GepOut)){
+            const GepInfo* info = getGepInfo(se.edge);
+            if(!info){
+                continue;
+            }
+            if(info->flags & GEP_VARIANT){
+                addNext(se.nbr->getId(), stack, true, taken, lanes);
+            }else if(info->flags & GEP_HAS_OFFSET){
+                addNext(se.nbr->getId(), offsetTop(stack, info->offset), true, taken, lanes);
+            }
+        }
+    }
+}
+
+bool BatchAlias::run(const vector<PAGNode*> &roots, const AliasBudget &budget){
+    assert(roots.size() <= BATCH_LANES && "BatchAlias: too many roots");
+    auto start = std::chrono::steady_clock::now();
+    truncated = TruncNone;
+    metrics = BatchMetrics();
+    stacks.reset();
+    seen.reset();
+    frontier.clear();
+    next.clear();
+    Aliases.resize(roots.size());
+    for(auto &aliases : Aliases){
+        aliases.clear();
+    }
+
+    // 起点不检查黑名单，与per-GV引擎相同。
+    level = 0;
+    const StackID bottom = stacks.push(EMPTY_STACK_ID, packItem(0, false));
+    for(size_t lane = 0; lane < roots.size(); lane++){
+        enqueue(roots[lane]->getId(), bottom, false, false, (LaneMask)1 << lane);
+    }
+    while(!next.empty() && truncated == TruncNone){
+        frontier.swap(next);
+        next.clear();
+        level++;
+        metrics.levels = level;
+        for(const auto &item : frontier){
+            if(!budget.unlimited()){
+                if(budget.steps && metrics.states >= budget.steps){
+                    truncated = TruncSteps;
+                    break;
+                }
+                if(budget.timeUs && metrics.states % BUDGET_CHECK_STEPS == 0
+                    && (u64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() >= budget.timeUs){
+                    truncated = TruncTime;
+                    break;
+                }
+            }
+            expand(item);
+        }
+    }
+    for(auto &aliases : Aliases){
+        aliases.finalize();
+    }
+    analysisUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return truncated == TruncNone;
+}
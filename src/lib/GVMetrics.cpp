@@ -0,0 +1,84 @@
+#include "../include/GVMetrics.hpp"
+#include "llvm/Support/raw_ostream.h"
+
+static string csvEscape(const string &str){
+    if(str.find_first_of(",\"\n") == string::npos){
+        return str;
+    }
+    string ret = "\"";
+    for(char c : str){
+        if(c == '"'){
+            ret += '"';
+        }
+        ret += c;
+    }
+    return ret + "\"";
+}
+
+bool GVMetricsWriter::open(const string &path){
+    csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    fout.open(path);
+    if(!fout.is_open()){
+        errs() << "[GVMetrics] Fail to open " << path << "\n";
+        return false;
+    }
+    if(csv){
+        fout << "gv,truncated,time_us,steps,calls,reject_black,reject_dyn_black,reject_edge_cap,reject_edge,reject_icall,reject_state,"
+             << "sc_typebased,sc_additional,sc_castsite,dyn_black_triggers,max_stack_depth,alias_offsets,alias_nodes,alias_bytes,aliases\n";
+    }
+    return true;
+}
+
+void GVMetricsWriter::close(){
+    if(fout.is_open()){
+        fout.close();
+        errs() << "[GVMetrics] " << records << " records written\n";
+    }
+}
+
+// 在锁外把整条记录拼好，锁内只做一次写入。
+void GVMetricsWriter::write(const string &gvName, const UniasAlgo &unias){
+    if(!fout.is_open()){
+        return;
+    }
+    const auto &m = unias.metrics;
+    u64_t aliasNodes = 0;
+    string aliases; // 各offset的alias节点数。
+    for(const auto &entry : unias.Aliases){
+        aliasNodes += entry.nodes.size();
+        if(csv){
+            aliases += (aliases.empty() ? "" : ";") + std::to_string(entry.offset) + ":" + std::to_string(entry.nodes.size());
+        }else{
+            aliases += (aliases.empty() ? "\"" : ",\"") + std::to_string(entry.offset) + "\":" + std::to_string(entry.nodes.size());
+        }
+    }
+    const u64_t values[] = {
+        unias.analysisUs, unias.traversal.stepsDone, m.calls, m.rejectBlack, m.rejectDynBlack, m.rejectEdgeCap,
+        m.rejectEdge, m.rejectIcall, m.rejectState, m.typebasedShortcuts, m.additionalShortcuts, m.castSiteShortcuts,
+        m.dynBlackTriggers, m.maxStackDepth, unias.Aliases.size(), aliasNodes, unias.Aliases.memoryBytes(),
+    };
+    static const char* const keys[] = {
+        "time_us", "steps", "calls", "reject_black", "reject_dyn_black", "reject_edge_cap",
+        "reject_edge", "reject_icall", "reject_state", "sc_typebased", "sc_additional", "sc_castsite",
+        "dyn_black_triggers", "max_stack_depth", "alias_offsets", "alias_nodes", "alias_bytes",
+    };
+    static_assert(sizeof(values) / sizeof(values[0]) == sizeof(keys) / sizeof(keys[0]), "GVMetrics keys/values mismatch");
+
+    string line;
+    if(csv){
+        line = csvEscape(gvName) + "," + truncReasonName(unias.truncated);
+        for(auto value : values){
+            line += "," + std::to_string(value);
+        }
+        line += "," + aliases + "\n";
+    }else{
+        line = "{\"gv\":\"" + jsonEscape(gvName) + "\",\"truncated\":\"" + truncReasonName(unias.truncated) + "\"";
+        for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++){
+            line += ",\"" + string(keys[i]) + "\":" + std::to_string(values[i]);
+        }
+        line += ",\"aliases\":{" + aliases + "}}\n";
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    fout << line;
+    records++;
+}
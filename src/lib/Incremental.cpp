@@ -0,0 +1,471 @@
+#include "../include/Incremental.hpp"
+#include "../include/PAGSnapshot.hpp"
+#include "../include/UtilLLVM.hpp"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+static const char INCREMENTAL_MAGIC[8] = {'U', 'N', 'I', 'A', 'S', 'I', 'N', 'C'};
+static const u64_t INCREMENTAL_END = 0x444e45524e434e49ull; // 文件尾标记，防止读到写了一半的文件。
+#define HASH_CHUNK (1 << 20)
+
+// 按8字节一组混合，比逐字节的FNV快得多，整个bc列表的内容hash和并发解析的耗时相当。
+u64_t hashBytes(const void* data, size_t len, u64_t seed){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    u64_t h = seed ^ mix64(len + 0x9e3779b97f4a7c15ull);
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        u64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ mix64(word)) * 0x9e3779b97f4a7c15ull;
+    }
+    u64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    return mix64(h ^ mix64(tail));
+}
+
+u64_t hashFileContent(const string &path){
+    if(path.empty()){
+        return 0;
+    }
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(!fp){
+        return 0;
+    }
+    vector<char> buf(HASH_CHUNK);
+    u64_t h = 0;
+    size_t n;
+    while((n = fread(buf.data(), 1, buf.size(), fp)) > 0){
+        h = hashBytes(buf.data(), n, h);
+    }
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    return ok ? (h ? h : 1) : 0;
+}
+
+static string statePath(const string &dir){
+    return dir + "/unias-incremental.bin";
+}
+
+bool IncrementalSession::loadState(const string &path){
+    string buf;
+    if(!readWholeFile(path, buf)){
+        return false;
+    }
+
+    BinaryReader r(buf);
+    char magic[8];
+    r.take(magic, sizeof(magic));
+    if(!r.ok || memcmp(magic, INCREMENTAL_MAGIC, sizeof(magic)) != 0 || r.get<u32_t>() != INCREMENTAL_VERSION){
+        errs() << "[Incremental] " << path << " is not a compatible state file\n";
+        return false;
+    }
+    if(r.get<u64_t>() != configKey){
+        errs() << "[Incremental] Options or auxiliary inputs changed, re-analyzing all GVs\n";
+        return false;
+    }
+    const u32_t moduleNum = r.get<u32_t>();
+    vector<u64_t> prevHashes;
+    for(u32_t i = 0; i < moduleNum && r.ok; i++){
+        prevModules.push_back(r.getString());
+        prevHashes.push_back(r.get<u64_t>());
+    }
+    const u32_t symbolNum = r.get<u32_t>();
+    for(u32_t i = 0; i < symbolNum && r.ok; i++){
+        prevSymbols.push_back(r.getString());
+        u32_t module = r.get<u32_t>();
+        prevSymbolModules.push_back(module < moduleNum ? module : NO_MODULE);
+    }
+    const u32_t structNum = r.get<u32_t>();
+    for(u32_t i = 0; i < structNum && r.ok; i++){
+        prevStructs.push_back(r.getString());
+        prevStructHashes.push_back(r.get<u64_t>());
+    }
+    const u32_t gvNum = r.get<u32_t>();
+    for(u32_t i = 0; i < gvNum && r.ok; i++){
+        const string gv = r.getString();
+        auto &symbolsOfGV = prevDeps[gv];
+        const u32_t num = r.get<u32_t>();
+        for(u32_t j = 0; j < num && r.ok; j++){
+            u32_t symbol = r.get<u32_t>();
+            if(symbol >= symbolNum){
+                r.ok = false;
+            }
+            symbolsOfGV.push_back(symbol);
+        }
+        auto &structsOfGV = prevStructDeps[gv];
+        const u32_t stNum = r.get<u32_t>();
+        for(u32_t j = 0; j < stNum && r.ok; j++){
+            u32_t st = r.get<u32_t>();
+            if(st >= structNum){
+                r.ok = false;
+            }
+            structsOfGV.push_back(st);
+        }
+    }
+    if(!r.atEnd(INCREMENTAL_END)){
+        errs() << "[Incremental] " << path << " is truncated or corrupted\n";
+        prevModules.clear();
+        prevSymbols.clear();
+        prevSymbolModules.clear();
+        prevDeps.clear();
+        prevStructs.clear();
+        prevStructHashes.clear();
+        prevStructDeps.clear();
+        return false;
+    }
+
+    // 与本次的模块列表对比。
+    unordered_map<string, u64_t> previous;
+    prevModuleDirty.assign(moduleNum, true);
+    for(u32_t i = 0; i < moduleNum; i++){
+        previous[prevModules[i]] = prevHashes[i];
+        auto it = moduleIndex.find(prevModules[i]);
+        prevModuleDirty[i] = it == moduleIndex.end() || hashes[it->second] == 0 || hashes[it->second] != prevHashes[i];
+    }
+    for(u32_t i = 0; i < modules.size(); i++){
+        auto it = previous.find(modules[i]);
+        moduleChanged[i] = it == previous.end() || hashes[i] == 0 || it->second != hashes[i];
+    }
+    return true;
+}
+
+void IncrementalSession::begin(const string &dir, const vector<string> &moduleNames, u64_t configKey, u32_t threadNum){
+    auto start = std::chrono::steady_clock::now();
+    this->dir = dir;
+    this->configKey = configKey;
+    modules = moduleNames;
+    for(u32_t i = 0; i < modules.size(); i++){
+        moduleIndex[modules[i]] = i;
+    }
+    hashes.assign(modules.size(), 0);
+    moduleChanged.assign(modules.size(), true);
+
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+        for(size_t i = next++; i < modules.size(); i = next++){
+            hashes[i] = hashFileContent(modules[i]);
+        }
+    };
+    threadNum = std::max<u32_t>(1, std::min<size_t>(threadNum, modules.size()));
+    vector<std::thread> threads;
+    for(u32_t i = 0; i < threadNum; i++){
+        threads.emplace_back(worker);
+    }
+    for(auto &t : threads){
+        t.join();
+    }
+    auto hashMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    hasPrevious = loadState(statePath(dir));
+    if(!hasPrevious){
+        errs() << "[Incremental] No usable previous state in " << dir << ", " << modules.size() << " modules hashed in "
+               << hashMs << "ms\n";
+        return;
+    }
+    u32_t changed = 0, added = 0, removed = 0;
+    unordered_set<string> previous(prevModules.begin(), prevModules.end());
+    for(u32_t i = 0; i < modules.size(); i++){
+        if(!previous.count(modules[i])){
+            added++;
+        }else if(moduleChanged[i]){
+            changed++;
+        }
+    }
+    for(auto &module : prevModules){
+        removed += !moduleIndex.count(module);
+    }
+    errs() << "[Incremental] " << modules.size() << " modules hashed in " << hashMs << "ms: " << changed << " changed, "
+           << added << " added, " << removed << " removed since the previous run\n";
+}
+
+u32_t IncrementalSession::internStruct(const string &name){
+    auto it = depStructIds.find(name);
+    if(it != depStructIds.end()){
+        return it->second;
+    }
+    const u32_t id = depStructs.size();
+    depStructs.push_back(name);
+    depStructIds.emplace(name, id);
+    return id;
+}
+
+u64_t IncrementalSession::getStructHash(const string &name) const{
+    auto it = structHashes.find(name);
+    return it == structHashes.end() ? 0 : it->second;
+}
+
+// 结构体的shortcut指纹：typebased边按两端节点所在的符号名和offset hash，additional按它指向的那组typebased边，
+// cast site按两端的符号名，求和与遍历顺序无关。
+void IncrementalSession::computeStructHashes(){
+    static const string noSymbol;
+    auto symbolOf = [&](NodeID id) -> const string& {
+        return id < node2Symbol.size() && node2Symbol[id] != NO_SYMBOL ? symbols[node2Symbol[id]] : noSymbol;
+    };
+    auto edgeHash = [&](u64_t kind, u64_t offset, const PAGEdge* edge){
+        const string buf = symbolOf(edge->getSrcID()) + '\0' + symbolOf(edge->getDstID());
+        return mix64(hashBytes(buf.data(), buf.size(), kind << 32 | offset));
+    };
+    auto nameOf = [](StructID st) -> const string& {
+        return st < structNames.size() ? structNames[st] : noSymbol;
+    };
+    for(auto &st : typebasedShortcuts){
+        u64_t &h = structHashes[nameOf(st.first)];
+        for(auto &off : st.second){
+            for(auto edge : off.second){
+                h += edgeHash(1, off.first, edge);
+            }
+        }
+    }
+    for(auto &st : additionalShortcuts){
+        u64_t &h = structHashes[nameOf(st.first)];
+        for(auto &off : st.second){
+            for(auto slot : off.second){
+                for(auto edge : *slot){
+                    h += edgeHash(2, off.first, edge);
+                }
+            }
+        }
+    }
+    for(auto &st : castSites){
+        u64_t &h = structHashes[nameOf(st.first)];
+        for(auto edge : st.second){
+            h += edgeHash(3, 0, edge);
+        }
+    }
+}
+
+u32_t IncrementalSession::internSymbol(const string &name, u32_t module){
+    string key = to_string(module) + ":" + name;
+    auto it = symbolIds.find(key);
+    if(it != symbolIds.end()){
+        return it->second;
+    }
+    const u32_t id = symbols.size();
+    symbols.push_back(name);
+    symbolModules.push_back(module);
+    symbolIds.emplace(std::move(key), id);
+    return id;
+}
+
+void IncrementalSession::buildSymbols(){
+    auto start = std::chrono::steady_clock::now();
+    auto getModuleIndex = [&](const llvm::Module* mod){
+        if(!mod){
+            return (u32_t)NO_MODULE;
+        }
+        auto it = moduleIndex.find(mod->getModuleIdentifier());
+        return it == moduleIndex.end() ? (u32_t)NO_MODULE : it->second;
+    };
+
+    // 节点所属的函数，或者节点本身对应的全局变量/函数。
+    unordered_map<const llvm::GlobalValue*, u32_t> owner2Symbol;
+    node2Symbol.assign(pagSnapshot.numNodes(), NO_SYMBOL);
+    for(NodeID id = 0; id < pagSnapshot.numNodes(); id++){
+        const llvm::GlobalValue* owner = getNodeOwner(pagSnapshot.getNode(id));
+        if(!owner){
+            continue;
+        }
+        auto it = owner2Symbol.find(owner);
+        if(it == owner2Symbol.end()){
+            it = owner2Symbol.emplace(owner, internSymbol(owner->getName().str(), getModuleIndex(owner->getParent()))).first;
+        }
+        node2Symbol[id] = it->second;
+    }
+
+    // 变化或新增的模块里声明/定义的所有符号名。
+    if(hasPrevious){
+        auto moduleSet = LLVMModuleSet::getLLVMModuleSet();
+        for(u32_t i = 0; i < moduleSet->getModuleNum(); i++){
+            const llvm::Module* mod = moduleSet->getModule(i);
+            const u32_t idx = getModuleIndex(mod);
+            if(idx == NO_MODULE || !moduleChanged[idx]){
+                continue;
+            }
+            for(auto &func : mod->functions()){
+                dirtyNames.insert(func.getName().str());
+            }
+            for(auto &global : mod->globals()){
+                dirtyNames.insert(global.getName().str());
+            }
+            for(auto &alias : mod->aliases()){
+                dirtyNames.insert(alias.getName().str());
+            }
+        }
+    }
+    computeStructHashes();
+    u32_t dirtyStructs = 0;
+    prevStructDirty.assign(prevStructs.size(), false);
+    for(u32_t i = 0; i < prevStructs.size(); i++){
+        prevStructDirty[i] = getStructHash(prevStructs[i]) != prevStructHashes[i];
+        dirtyStructs += prevStructDirty[i];
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[Incremental] " << symbols.size() << " symbols, " << dirtyNames.size()
+           << " names referenced by changed modules, " << structHashes.size() << " structs with shortcuts ("
+           << dirtyStructs << " changed), " << ms << "ms\n";
+}
+
+bool IncrementalSession::needsRerun(const string &gv) const{
+    if(!hasPrevious){
+        return true;
+    }
+    auto it = prevDeps.find(gv);
+    if(it == prevDeps.end()){
+        return true;
+    }
+    for(u32_t symbol : it->second){
+        const u32_t module = prevSymbolModules[symbol];
+        if((module != NO_MODULE && prevModuleDirty[module]) || dirtyNames.count(prevSymbols[symbol])){
+            return true;
+        }
+    }
+    auto structs = prevStructDeps.find(gv);
+    if(structs != prevStructDeps.end()){
+        for(u32_t st : structs->second){
+            if(prevStructDirty[st]){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void IncrementalSession::record(const string &gv, const vector<NodeID> &entered){
+    vector<u32_t> ids;
+    vector<StructID> structs;
+    ids.reserve(entered.size());
+    auto addSymbol = [&](NodeID id){
+        if(id < node2Symbol.size() && node2Symbol[id] != NO_SYMBOL){
+            ids.push_back(node2Symbol[id]);
+        }
+    };
+    for(NodeID id : entered){
+        addSymbol(id);
+        const u32_t mask = pagSnapshot.getMask(id);
+        for(u32_t g = 0; g < SG_Num; g++){
+            if(!((mask >> g) & 1)){
+                continue;
+            }
+            for(auto &se : pagSnapshot.get(id, (SnapGroup)g)){
+                // 被blackNodes挡住的邻居没有进入，它是否在黑名单里取决于全程序。
+                if(isBlackNode(se.nbr->getId())){
+                    addSymbol(se.nbr->getId());
+                }
+                // 反向GEP边上查询shortcut/cast site的结构体。
+                const GepInfo* info = g == SG_GepIn ? getGepInfo(se.edge) : nullptr;
+                if(info && (info->flags & GEP_HAS_OFFSET) && info->stID < structNames.size()){
+                    structs.push_back(info->stID);
+                }
+            }
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::sort(structs.begin(), structs.end());
+    structs.erase(std::unique(structs.begin(), structs.end()), structs.end());
+
+    // 同名的GV共用一份依赖。
+    std::lock_guard<std::mutex> lock(mtx);
+    auto &symbolsOfGV = deps[gv];
+    symbolsOfGV.insert(symbolsOfGV.end(), ids.begin(), ids.end());
+    std::sort(symbolsOfGV.begin(), symbolsOfGV.end());
+    symbolsOfGV.erase(std::unique(symbolsOfGV.begin(), symbolsOfGV.end()), symbolsOfGV.end());
+    auto &structsOfGV = structDeps[gv];
+    for(StructID st : structs){
+        structsOfGV.push_back(internStruct(structNames[st]));
+    }
+    std::sort(structsOfGV.begin(), structsOfGV.end());
+    structsOfGV.erase(std::unique(structsOfGV.begin(), structsOfGV.end()), structsOfGV.end());
+}
+
+void IncrementalSession::drop(const string &gv){
+    std::lock_guard<std::mutex> lock(mtx);
+    dropped.insert(gv);
+}
+
+void IncrementalSession::reuse(const string &gv){
+    auto it = prevDeps.find(gv);
+    if(it == prevDeps.end()){
+        return;
+    }
+    auto &symbolsOfGV = deps[gv];
+    for(u32_t symbol : it->second){
+        u32_t module = NO_MODULE;
+        if(prevSymbolModules[symbol] != NO_MODULE){
+            auto mod = moduleIndex.find(prevModules[prevSymbolModules[symbol]]);
+            module = mod == moduleIndex.end() ? NO_MODULE : mod->second;
+        }
+        symbolsOfGV.push_back(internSymbol(prevSymbols[symbol], module));
+    }
+    std::sort(symbolsOfGV.begin(), symbolsOfGV.end());
+    symbolsOfGV.erase(std::unique(symbolsOfGV.begin(), symbolsOfGV.end()), symbolsOfGV.end());
+    auto structs = prevStructDeps.find(gv);
+    if(structs != prevStructDeps.end()){
+        auto &structsOfGV = structDeps[gv];
+        for(u32_t st : structs->second){
+            structsOfGV.push_back(internStruct(prevStructs[st]));
+        }
+        std::sort(structsOfGV.begin(), structsOfGV.end());
+        structsOfGV.erase(std::unique(structsOfGV.begin(), structsOfGV.end()), structsOfGV.end());
+    }
+}
+
+bool IncrementalSession::finish(){
+    BinaryWriter w;
+    w.put(INCREMENTAL_MAGIC);
+    w.put((u32_t)INCREMENTAL_VERSION);
+    w.put(configKey);
+    w.put((u32_t)modules.size());
+    for(u32_t i = 0; i < modules.size(); i++){
+        w.putString(modules[i]);
+        w.put(hashes[i]);
+    }
+    w.put((u32_t)symbols.size());
+    for(u32_t i = 0; i < symbols.size(); i++){
+        w.putString(symbols[i]);
+        w.put(symbolModules[i]);
+    }
+    w.put((u32_t)depStructs.size());
+    for(auto &name : depStructs){
+        w.putString(name);
+        w.put(getStructHash(name));
+    }
+    u32_t gvNum = 0;
+    for(auto &gv : deps){
+        gvNum += !dropped.count(gv.first);
+    }
+    w.put(gvNum);
+    for(auto &gv : deps){
+        if(dropped.count(gv.first)){
+            continue;
+        }
+        w.putString(gv.first);
+        w.put((u32_t)gv.second.size());
+        for(u32_t symbol : gv.second){
+            w.put(symbol);
+        }
+        auto structs = structDeps.find(gv.first);
+        w.put((u32_t)(structs == structDeps.end() ? 0 : structs->second.size()));
+        if(structs != structDeps.end()){
+            for(u32_t st : structs->second){
+                w.put(st);
+            }
+        }
+    }
+    w.put(INCREMENTAL_END);
+
+    // 先替换结果再写状态：状态没有写成功时，下次仍与旧状态对比，这次变化的模块仍算作变化，不会漏掉重新分析。
+    const string path = statePath(dir);
+    if(rename(pendingResultsPath().c_str(), previousResultsPath().c_str()) != 0 || !writeFileAtomically(path, w.buf)){
+        errs() << "[Incremental] Fail to write " << path << "\n";
+        return false;
+    }
+    errs() << "[Incremental] Saved " << path << ", " << gvNum << " GVs, " << w.buf.size() / 1024 << "KB\n";
+    return true;
+}
@@ -0,0 +1,391 @@
+#include "../include/InitCache.hpp"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char INIT_CACHE_MAGIC[8] = {'U', 'N', 'I', 'A', 'S', 'I', 'C', '\0'};
+static const u64_t INIT_CACHE_END = 0x444e45454843414eull; // 文件尾标记，防止读到写了一半的文件。
+
+typedef unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> GroupedEdgeMap;
+
+// 文件头：除magic外都用于校验缓存是否属于当前输入和当前PAG。
+struct InitCacheHeader {
+    char magic[8];
+    u32_t version;
+    u32_t gepInfoSize; // sizeof(GepInfo)，gepInfos按原始字节存储。
+    u64_t key;
+    u64_t nodeIDBound;
+    u64_t stmtNums[4]; // Gep、Copy、Phi、Select边的数量。
+};
+
+// 缓存里出现的边只有这几类：shortcuts里的Gep边、castSites里的Copy边、phi/select表里的边。
+static void getStmtNums(SVFIR* pag, u64_t nums[4]){
+    nums[0] = pag->getSVFStmtSet(PAGEdge::Gep).size();
+    nums[1] = pag->getSVFStmtSet(PAGEdge::Copy).size();
+    nums[2] = pag->getPTASVFStmtSet(PAGEdge::Phi).size();
+    nums[3] = pag->getPTASVFStmtSet(PAGEdge::Select).size();
+}
+
+static void fnv1a(u64_t &h, const void* data, size_t len){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < len; i++){
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+}
+
+template <typename T>
+static void fnv1a(u64_t &h, const T &val){
+    fnv1a(h, &val, sizeof(T));
+}
+
+u64_t computeInitCacheKey(const vector<string> &inputFiles){
+    u64_t h = 0xcbf29ce484222325ull;
+    fnv1a(h, (u32_t)INIT_CACHE_VERSION);
+    fnv1a(h, (u64_t)BASE_NUM);
+    fnv1a(h, (u64_t)O_BASE);
+    fnv1a(h, (u64_t)SC_THRESHOLD);
+    for(auto &file : inputFiles){
+        fnv1a(h, file.data(), file.size() + 1);
+        struct stat st;
+        if(!file.empty() && stat(file.c_str(), &st) == 0){
+            fnv1a(h, (u64_t)st.st_size);
+            fnv1a(h, (u64_t)st.st_mtime);
+        }
+    }
+    for(auto &deny : allocDenyList){
+        fnv1a(h, deny.data(), deny.size() + 1);
+    }
+    return h;
+}
+
+string getInitCachePath(const string &dir, u64_t key){
+    char name[64];
+    snprintf(name, sizeof(name), "unias-init-%016llx.bin", (unsigned long long)key);
+    return dir.empty() ? string(name) : dir + "/" + name;
+}
+
+//
+// 写缓存。
+//
+
+class CacheWriter : public BinaryWriter {
+public:
+    void putBits(const BitVector &bits){
+        put((u64_t)bits.size());
+        put((u64_t)bits.count());
+        for(auto i : bits.set_bits()){
+            put((u32_t)i);
+        }
+    }
+
+    void putEdges(const unordered_set<PAGEdge*> &edges){
+        put((u32_t)edges.size());
+        for(auto edge : edges){
+            put((u32_t)edge->getEdgeID());
+        }
+    }
+
+    void putGrouped(const GroupedEdgeMap &table){
+        put((u64_t)table.size());
+        for(auto &node : table){
+            put((u32_t)node.first);
+            put((u32_t)node.second.size());
+            for(auto &edge : node.second){
+                put((u32_t)edge.first->getEdgeID());
+                put((u32_t)edge.second.size());
+                for(auto nbr : edge.second){
+                    put((u32_t)nbr);
+                }
+            }
+        }
+    }
+};
+
+bool saveInitCache(const string &path, u64_t key, SVFIR* pag){
+    auto start = std::chrono::steady_clock::now();
+    CacheWriter w;
+
+    InitCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INIT_CACHE_MAGIC, sizeof(header.magic));
+    header.version = INIT_CACHE_VERSION;
+    header.gepInfoSize = sizeof(GepInfo);
+    header.key = key;
+    header.nodeIDBound = nodeIDBound;
+    getStmtNums(pag, header.stmtNums);
+    w.put(header);
+
+    w.putBits(blackNodes);
+    w.putBits(blockedCallEdges);
+    w.putGrouped(phiIn);
+    w.putGrouped(phiOut);
+    w.putGrouped(selectIn);
+    w.putGrouped(selectOut);
+
+    w.put((u64_t)structNames.size());
+    for(auto &name : structNames){
+        w.putString(name);
+    }
+    w.put((u64_t)node2StructID.size());
+    w.putBytes(node2StructID.data(), node2StructID.size() * sizeof(StructID));
+    w.put((u64_t)gepInfos.size());
+    w.putBytes(gepInfos.data(), gepInfos.size() * sizeof(GepInfo));
+
+    // additionalShortcuts存的是指向typebasedShortcuts内层集合的指针，落盘时换成(structID, offset)。
+    unordered_map<const unordered_set<PAGEdge*>*, pair<StructID, u32_t>> shortcutSlots;
+    w.put((u64_t)typebasedShortcuts.size());
+    for(auto &st : typebasedShortcuts){
+        w.put((u32_t)st.first);
+        w.put((u32_t)st.second.size());
+        for(auto &off : st.second){
+            w.put((u32_t)off.first);
+            w.putEdges(off.second);
+            shortcutSlots[&off.second] = make_pair(st.first, off.first);
+        }
+    }
+    w.put((u64_t)additionalShortcuts.size());
+    for(auto &st : additionalShortcuts){
+        w.put((u32_t)st.first);
+        w.put((u32_t)st.second.size());
+        for(auto &off : st.second){
+            w.put((u32_t)off.first);
+            w.put((u32_t)off.second.size());
+            for(auto slot : off.second){
+                auto it = shortcutSlots.find(slot);
+                if(it == shortcutSlots.end()){
+                    errs() << "[InitCache] additionalShortcuts points outside typebasedShortcuts, skip saving.\n";
+                    return false;
+                }
+                w.put((u32_t)it->second.first);
+                w.put((u32_t)it->second.second);
+            }
+        }
+    }
+    w.put((u64_t)castSites.size());
+    for(auto &st : castSites){
+        w.put((u32_t)st.first);
+        w.putEdges(st.second);
+    }
+    w.put(INIT_CACHE_END);
+
+    if(!writeFileAtomically(path, w.buf)){
+        errs() << "[InitCache] Fail to write " << path << "\n";
+        return false;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[InitCache] Saved " << path << ", " << w.buf.size() / 1024 << "KB, " << ms << "ms\n";
+    return true;
+}
+
+//
+// 读缓存。
+//
+
+// 在mmap的只读内存上顺序读取，边按EdgeID查回当前PAG中的PAGEdge*。
+class CacheReader : public BinaryReader {
+public:
+    CacheReader(const char* begin, const char* end, const vector<PAGEdge*> &edges) : BinaryReader(begin, end), edges(edges) {}
+
+    PAGEdge* getEdge(){
+        u32_t id = get<u32_t>();
+        if(id >= edges.size() || !edges[id]){
+            ok = false;
+            return nullptr;
+        }
+        return edges[id];
+    }
+
+    void getBits(BitVector &bits){
+        u64_t size = get<u64_t>();
+        u64_t count = get<u64_t>();
+        bits.clear();
+        bits.resize(size);
+        for(u64_t i = 0; i < count && ok; i++){
+            u32_t idx = get<u32_t>();
+            if(idx >= size){
+                ok = false;
+                return;
+            }
+            bits.set(idx);
+        }
+    }
+
+    void getEdges(unordered_set<PAGEdge*> &set){
+        u32_t n = get<u32_t>();
+        for(u32_t i = 0; i < n && ok; i++){
+            set.insert(getEdge());
+        }
+    }
+
+    void getGrouped(GroupedEdgeMap &table){
+        u64_t nodeNum = get<u64_t>();
+        for(u64_t i = 0; i < nodeNum && ok; i++){
+            auto &node = table[get<u32_t>()];
+            u32_t edgeNum = get<u32_t>();
+            for(u32_t j = 0; j < edgeNum && ok; j++){
+                auto &nbrs = node[getEdge()];
+                u32_t nbrNum = get<u32_t>();
+                for(u32_t k = 0; k < nbrNum && ok; k++){
+                    nbrs.insert(get<u32_t>());
+                }
+            }
+        }
+    }
+
+private:
+    const vector<PAGEdge*> &edges;
+};
+
+static void addEdges(vector<PAGEdge*> &edges, SVFIR* pag, PAGEdge::PEDGEK kind, bool pta){
+    for(auto edge : (pta ? pag->getPTASVFStmtSet(kind) : pag->getSVFStmtSet(kind))){
+        if(edge->getEdgeID() >= edges.size()){
+            edges.resize(edge->getEdgeID() + 1, nullptr);
+        }
+        edges[edge->getEdgeID()] = edge;
+    }
+}
+
+bool loadInitCache(const string &path, u64_t key, SVFIR* pag){
+    auto start = std::chrono::steady_clock::now();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        errs() << "[InitCache] No cache at " << path << ", run the full initialization.\n";
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(InitCacheHeader)){
+        close(fd);
+        errs() << "[InitCache] Broken cache " << path << "\n";
+        return false;
+    }
+    const size_t size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED){
+        errs() << "[InitCache] Fail to mmap " << path << "\n";
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(mapped);
+
+    InitCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    u64_t stmtNums[4];
+    getStmtNums(pag, stmtNums);
+    if(memcmp(header.magic, INIT_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != INIT_CACHE_VERSION
+        || header.gepInfoSize != sizeof(GepInfo) || header.key != key
+        || header.nodeIDBound != getNodeIDBound(pag) || memcmp(header.stmtNums, stmtNums, sizeof(stmtNums)) != 0){
+        munmap(mapped, size);
+        errs() << "[InitCache] Stale cache " << path << ", run the full initialization.\n";
+        return false;
+    }
+
+    vector<PAGEdge*> edges;
+    addEdges(edges, pag, PAGEdge::Gep, false);
+    addEdges(edges, pag, PAGEdge::Copy, false);
+    addEdges(edges, pag, PAGEdge::Phi, true);
+    addEdges(edges, pag, PAGEdge::Select, true);
+    CacheReader r(data + sizeof(header), data + size, edges);
+
+    // 先读到局部变量里，全部读完且校验通过后再替换全局表。
+    BitVector black, blocked;
+    GroupedEdgeMap pIn, pOut, sIn, sOut;
+    vector<string> names;
+    vector<StructID> nodeIDs;
+    vector<GepInfo> geps;
+    unordered_map<StructID, unordered_map<u32_t, unordered_set<PAGEdge*>>> typebased;
+    unordered_map<StructID, unordered_map<u32_t, unordered_set<unordered_set<PAGEdge*>*>>> additional;
+    unordered_map<StructID, unordered_set<PAGEdge*>> casts;
+
+    r.getBits(black);
+    r.getBits(blocked);
+    r.getGrouped(pIn);
+    r.getGrouped(pOut);
+    r.getGrouped(sIn);
+    r.getGrouped(sOut);
+
+    u64_t nameNum = r.get<u64_t>();
+    for(u64_t i = 0; i < nameNum && r.ok; i++){
+        names.push_back(r.getString());
+    }
+    u64_t nodeNum = r.get<u64_t>();
+    if(r.ok && nodeNum <= size){
+        nodeIDs.resize(nodeNum);
+        r.take(nodeIDs.data(), nodeNum * sizeof(StructID));
+    }else{
+        r.ok = false;
+    }
+    u64_t gepNum = r.get<u64_t>();
+    if(r.ok && gepNum <= size){
+        geps.resize(gepNum);
+        r.take(geps.data(), gepNum * sizeof(GepInfo));
+    }else{
+        r.ok = false;
+    }
+
+    u64_t stNum = r.get<u64_t>();
+    for(u64_t i = 0; i < stNum && r.ok; i++){
+        auto &offsets = typebased[r.get<u32_t>()];
+        u32_t offNum = r.get<u32_t>();
+        for(u32_t j = 0; j < offNum && r.ok; j++){
+            r.getEdges(offsets[r.get<u32_t>()]);
+        }
+    }
+    stNum = r.get<u64_t>();
+    for(u64_t i = 0; i < stNum && r.ok; i++){
+        auto &offsets = additional[r.get<u32_t>()];
+        u32_t offNum = r.get<u32_t>();
+        for(u32_t j = 0; j < offNum && r.ok; j++){
+            auto &slots = offsets[r.get<u32_t>()];
+            u32_t slotNum = r.get<u32_t>();
+            for(u32_t k = 0; k < slotNum && r.ok; k++){
+                StructID srcID = r.get<u32_t>();
+                u32_t srcOff = r.get<u32_t>();
+                auto stIt = typebased.find(srcID);
+                if(stIt == typebased.end() || stIt->second.find(srcOff) == stIt->second.end()){
+                    r.ok = false;
+                    break;
+                }
+                slots.insert(&stIt->second[srcOff]);
+            }
+        }
+    }
+    stNum = r.get<u64_t>();
+    for(u64_t i = 0; i < stNum && r.ok; i++){
+        r.getEdges(casts[r.get<u32_t>()]);
+    }
+    const bool ok = r.atEnd(INIT_CACHE_END);
+    munmap(mapped, size);
+    if(!ok){
+        errs() << "[InitCache] Broken cache " << path << ", run the full initialization.\n";
+        return false;
+    }
+
+    // typebasedShortcuts整体move，内层集合的地址不变，additionalShortcuts里的指针仍然有效。
+    nodeIDBound = header.nodeIDBound;
+    blackNodes = std::move(black);
+    blockedCallEdges = std::move(blocked);
+    phiIn = std::move(pIn);
+    phiOut = std::move(pOut);
+    selectIn = std::move(sIn);
+    selectOut = std::move(sOut);
+    structNames = std::move(names);
+    node2StructID = std::move(nodeIDs);
+    gepInfos = std::move(geps);
+    typebasedShortcuts = std::move(typebased);
+    additionalShortcuts = std::move(additional);
+    castSites = std::move(casts);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[InitCache] Loaded " << path << ", " << size / 1024 << "KB, " << ms << "ms\n";
+    errs() << "blackNodes: " << blackNodes.count() << ", struct IDs: " << structNames.size()
+           << ", gepInfos: " << gepInfos.size() << ", typebased shortcuts: " << typebasedShortcuts.size()
+           << ", castSites: " << castSites.size() << "\n";
+    return true;
+}
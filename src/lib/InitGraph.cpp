@@ -0,0 +1,162 @@
+#include "../include/InitGraph.hpp"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+static u64_t elapsedUs(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static thread_local raw_string_ostream* curTaskLog = nullptr; // 为空表示不在InitGraph的阶段里。
+static std::mutex logMutex;
+
+raw_ostream &initLog(){
+    if(curTaskLog){
+        return *curTaskLog;
+    }
+    return errs();
+}
+
+InitGraph::TaskID InitGraph::add(const string &name, std::function<void()> fn, const vector<TaskID> &deps, u32_t reads, u32_t writes){
+    const TaskID id = tasks.size();
+    tasks.emplace_back();
+    auto &task = tasks.back();
+    task.name = name;
+    task.fn = std::move(fn);
+    task.deps = deps;
+    task.reads = reads;
+    task.writes = writes;
+    task.ancestors.assign(id, false);
+    for(auto dep : deps){
+        assert(dep < id && "InitGraph: a task can only depend on tasks added before it");
+        tasks[dep].succs.push_back(id);
+        task.ancestors[dep] = true;
+        for(TaskID anc = 0; anc < dep; anc++){
+            if(tasks[dep].ancestors[anc]){
+                task.ancestors[anc] = true;
+            }
+        }
+    }
+    // 串行顺序里排在前面、读写冲突的阶段必须在依赖链上，否则并发时结果与串行不同。
+    for(TaskID prev = 0; prev < id; prev++){
+        assert((!conflicts(tasks[prev], task) || task.ancestors[prev]) && "InitGraph: a task conflicts with an earlier task it does not depend on");
+    }
+    return id;
+}
+
+void InitGraph::execute(Task &task, std::chrono::steady_clock::time_point start){
+    string log;
+    raw_string_ostream stream(log);
+    curTaskLog = &stream;
+    task.startUs = elapsedUs(start);
+    task.fn();
+    task.endUs = elapsedUs(start);
+    curTaskLog = nullptr;
+    std::lock_guard<std::mutex> guard(logMutex);
+    errs() << stream.str();
+}
+
+void InitGraph::run(u32_t threadNum){
+    const auto start = std::chrono::steady_clock::now();
+    threadNum = std::max<u32_t>(1, std::min<size_t>(threadNum, tasks.size()));
+    if(threadNum == 1){
+        for(auto &task : tasks){
+            execute(task, start);
+        }
+        printStats(elapsedUs(start), threadNum);
+        return;
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::set<TaskID> ready; // 有序集合：多个阶段同时就绪时，先执行加入得早的。
+    vector<u32_t> pendingDeps(tasks.size());
+    vector<TaskID> running; // 正在执行的阶段，只用于断言。
+    size_t finished = 0;
+    for(TaskID id = 0; id < tasks.size(); id++){
+        pendingDeps[id] = tasks[id].deps.size();
+        if(pendingDeps[id] == 0){
+            ready.insert(id);
+        }
+    }
+
+    auto worker = [&](){
+        std::unique_lock<std::mutex> lock(mtx);
+        while(true){
+            cv.wait(lock, [&](){ return !ready.empty() || finished == tasks.size(); });
+            if(ready.empty()){
+                return;
+            }
+            const TaskID id = *ready.begin();
+            ready.erase(ready.begin());
+            auto &task = tasks[id];
+            for(auto other : running){
+                assert(!conflicts(tasks[other], task) && "InitGraph: conflicting tasks running concurrently");
+            }
+            running.push_back(id);
+            lock.unlock();
+            execute(task, start);
+            lock.lock();
+            running.erase(std::find(running.begin(), running.end(), id));
+            finished++;
+            for(auto succ : task.succs){
+                if(--pendingDeps[succ] == 0){
+                    ready.insert(succ);
+                }
+            }
+            cv.notify_all();
+        }
+    };
+    vector<std::thread> threads;
+    for(u32_t i = 0; i < threadNum; i++){
+        threads.emplace_back(worker);
+    }
+    for(auto &thread : threads){
+        thread.join();
+    }
+    printStats(elapsedUs(start), threadNum);
+}
+
+void InitGraph::printStats(u64_t wallUs, u32_t threadNum) const{
+    // 关键路径：沿依赖边累加各阶段耗时的最长路径，是多线程下initialize的耗时下限。
+    vector<u64_t> pathUs(tasks.size(), 0);
+    vector<TaskID> pathPrev(tasks.size(), (TaskID)-1);
+    u64_t sumUs = 0;
+    TaskID last = 0;
+    for(TaskID id = 0; id < tasks.size(); id++){
+        const auto &task = tasks[id];
+        const u64_t us = task.endUs - task.startUs;
+        sumUs += us;
+        for(auto dep : task.deps){
+            if(pathUs[dep] > pathUs[id]){
+                pathUs[id] = pathUs[dep];
+                pathPrev[id] = dep;
+            }
+        }
+        pathUs[id] += us;
+        if(pathUs[id] > pathUs[last]){
+            last = id;
+        }
+    }
+
+    errs() << "[initialize] Setup phases on " << threadNum << " threads:\n";
+    for(auto &task : tasks){
+        errs() << "  " << task.name << ": " << (task.endUs - task.startUs) / 1000 << "ms (start +" << task.startUs / 1000 << "ms)\n";
+    }
+    vector<string> path;
+    for(TaskID id = last; id != (TaskID)-1 && !tasks.empty(); id = pathPrev[id]){
+        path.push_back(tasks[id].name);
+    }
+    std::reverse(path.begin(), path.end());
+    errs() << "[initialize] Setup wall " << wallUs / 1000 << "ms, sum of phases " << sumUs / 1000 << "ms, speedup "
+           << format("%.2f", wallUs ? (double)sumUs / wallUs : 1.0) << "x, critical path " << (tasks.empty() ? 0 : pathUs[last]) / 1000 << "ms:";
+    for(size_t i = 0; i < path.size(); i++){
+        errs() << (i ? " -> " : " ") << path[i];
+    }
+    errs() << "\n";
+}
@@ -0,0 +1,137 @@
+#include "../include/ModuleLoader.hpp"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+static u64_t elapsedUs(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 顺序读完整个文件让内核预读，文件留在page cache里。keepAll为false时buf中只保留开头一块（用于检查文件头）。
+static bool readFile(const string &path, string &buf, bool keepAll, u64_t &bytes, string &error){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        error = strerror(errno);
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buf.clear();
+    bytes = 0;
+    char chunk[1 << 16];
+    ssize_t n;
+    while((n = read(fd, chunk, sizeof(chunk))) > 0){
+        if(keepAll || bytes == 0){
+            buf.append(chunk, n);
+        }
+        bytes += n;
+    }
+    if(n < 0){
+        error = strerror(errno);
+    }
+    close(fd);
+    return n == 0;
+}
+
+vector<ModuleLoadStat> prefetchModules(const vector<string> &moduleNames, u32_t threadNum, bool fullParse){
+    vector<ModuleLoadStat> stats(moduleNames.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+        LLVMContext ctx; // 每个线程独立的context，线程之间不共享任何LLVM对象。
+        string buf;      // 跨模块复用。
+        for(size_t i = next++; i < moduleNames.size(); i = next++){
+            auto &st = stats[i];
+            st.path = moduleNames[i];
+            auto start = std::chrono::steady_clock::now();
+            const bool readable = readFile(st.path, buf, fullParse, st.bytes, st.error);
+            st.readUs = elapsedUs(start);
+            if(!readable){
+                continue;
+            }
+            const auto* begin = reinterpret_cast<const unsigned char*>(buf.data());
+            if(!fullParse){
+                // 不是bitcode的文件（例如文本IR）仍交给SVF，只报告出来。
+                st.loadable = true;
+                st.ok = isBitcode(begin, begin + buf.size());
+                if(!st.ok){
+                    st.error = "not a bitcode file";
+                }
+                continue;
+            }
+            SMDiagnostic err;
+            start = std::chrono::steady_clock::now();
+            std::unique_ptr<Module> mod = parseIR(MemoryBufferRef(buf, st.path), err, ctx);
+            st.parseUs = elapsedUs(start);
+            if(!mod){
+                st.error = err.getMessage().str();
+                continue;
+            }
+            st.loadable = true;
+            st.ok = true;
+            start = std::chrono::steady_clock::now();
+            string msg;
+            raw_string_ostream os(msg);
+            if(verifyModule(*mod, &os)){
+                st.ok = false;
+                st.error = os.str();
+            }
+            st.verifyUs = elapsedUs(start);
+        }
+    };
+
+    threadNum = std::max<u32_t>(1, std::min<size_t>(threadNum, moduleNames.size()));
+    vector<std::thread> threads;
+    for(u32_t i = 0; i < threadNum; i++){
+        threads.emplace_back(worker);
+    }
+    for(auto &t : threads){
+        t.join();
+    }
+    return stats;
+}
+
+void printPrefetchStats(const vector<ModuleLoadStat> &stats, u64_t wallUs, u32_t threadNum){
+    u64_t readUs = 0, parseUs = 0, verifyUs = 0, bytes = 0, failed = 0, dropped = 0;
+    for(auto &st : stats){
+        readUs += st.readUs;
+        parseUs += st.parseUs;
+        verifyUs += st.verifyUs;
+        bytes += st.bytes;
+        failed += !st.ok;
+        dropped += !st.loadable;
+    }
+    errs() << "[Prefetch] " << stats.size() << " modules, " << bytes / 1024 / 1024 << "MB, "
+           << threadNum << " threads, wall " << wallUs / 1000 << "ms, read " << readUs / 1000 << "ms, parse "
+           << parseUs / 1000 << "ms, verify " << verifyUs / 1000 << "ms (summed over threads), failed " << failed
+           << ", dropped " << dropped << "\n";
+
+    vector<const ModuleLoadStat*> sorted;
+    for(auto &st : stats){
+        sorted.push_back(&st);
+    }
+    const size_t k = std::min<size_t>(10, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + k, sorted.end(), [](const ModuleLoadStat* a, const ModuleLoadStat* b){
+        return a->readUs + a->parseUs + a->verifyUs > b->readUs + b->parseUs + b->verifyUs;
+    });
+    for(size_t i = 0; i < k; i++){
+        errs() << "  slowest: " << sorted[i]->path << " " << sorted[i]->bytes / 1024 << "KB, read "
+               << sorted[i]->readUs / 1000 << "ms, parse " << sorted[i]->parseUs / 1000 << "ms, verify "
+               << sorted[i]->verifyUs / 1000 << "ms\n";
+    }
+    for(auto &st : stats){
+        if(!st.ok){
+            errs() << "  failed: " << st.path << ": " << st.error << "\n";
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#include "../include/PAGSnapshot.hpp"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+
+PAGSnapshot pagSnapshot;
+
+// 把nested map形式的phi/select表展开成(dst, 边)项。
+static void appendGrouped(vector<SnapEdge> &entries, SVFIR* pag,
+                          const unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> &table, NodeID id){
+    auto it = table.find(id);
+    if(it == table.end()){
+        return;
+    }
+    for(auto &edge : it->second){
+        for(auto nbr : edge.second){
+            entries.push_back(SnapEdge{pag->getGNode(nbr), edge.first});
+        }
+    }
+}
+
+static void appendMapped(vector<SnapEdge> &entries, SVFIR* pag,
+                         const unordered_map<NodeID, unordered_set<NodeID>> &table, NodeID id){
+    auto it = table.find(id);
+    if(it == table.end()){
+        return;
+    }
+    for(auto nbr : it->second){
+        entries.push_back(SnapEdge{pag->getGNode(nbr), nullptr});
+    }
+}
+
+static void appendOut(vector<SnapEdge> &entries, PAGNode* node, PAGEdge::PEDGEK kind){
+    if(node->hasOutgoingEdges(kind)){
+        for(auto edge : node->getOutgoingEdges(kind)){
+            entries.push_back(SnapEdge{edge->getDstNode(), edge});
+        }
+    }
+}
+
+// Call/Ret边只保留callee可进入的，见setupCallAdmissibility。
+static void appendAdmissibleOut(vector<SnapEdge> &entries, PAGNode* node, PAGEdge::PEDGEK kind){
+    if(node->hasOutgoingEdges(kind)){
+        for(auto edge : node->getOutgoingEdges(kind)){
+            if(!isBlockedCallEdge(edge)){
+                entries.push_back(SnapEdge{edge->getDstNode(), edge});
+            }
+        }
+    }
+}
+
+static void appendAdmissibleIn(vector<SnapEdge> &entries, PAGNode* node, PAGEdge::PEDGEK kind){
+    if(node->hasIncomingEdges(kind)){
+        for(auto edge : node->getIncomingEdges(kind)){
+            if(!isBlockedCallEdge(edge)){
+                entries.push_back(SnapEdge{edge->getSrcNode(), edge});
+            }
+        }
+    }
+}
+
+static void appendIn(vector<SnapEdge> &entries, PAGNode* node, PAGEdge::PEDGEK kind){
+    if(node->hasIncomingEdges(kind)){
+        for(auto edge : node->getIncomingEdges(kind)){
+            entries.push_back(SnapEdge{edge->getSrcNode(), edge});
+        }
+    }
+}
+
+// groupStart、groupEnds用u32_t存下标，先检查再收窄。截断后的下标会让快照静默地指到别的节点的边，所以直接终止。
+static u32_t snapIndex(size_t n){
+    if(n >= UINT32_MAX){
+        report_fatal_error("PAGSnapshot: too many adjacency entries for u32_t indices");
+    }
+    return (u32_t)n;
+}
+
+// [initialize] 必须在phi/select、CallGraph、blockedCallEdges等表都建好之后调用，此后这些表的修改不会反映到快照中。
+void PAGSnapshot::build(SVFIR* pag){
+    auto start = std::chrono::steady_clock::now();
+    const NodeID bound = nodeIDBound ? nodeIDBound : getNodeIDBound(pag);
+    nodes.assign(bound, nullptr);
+    for(auto it = pag->begin(), ie = pag->end(); it != ie; ++it){
+        nodes[it->first] = it->second;
+    }
+    masks.assign(bound, 0);
+    groupStart.assign(bound, 0);
+    groupEnds.clear();
+    entries.clear();
+
+    for(NodeID id = 0; id < bound; id++){
+        PAGNode* node = nodes[id];
+        groupStart[id] = snapIndex(groupEnds.size());
+        groupEnds.push_back(snapIndex(entries.size()));
+        if(!node){
+            continue;
+        }
+        for(u32_t g = 0; g < SG_Num; g++){
+            const size_t before = entries.size();
+            switch(g){
+                case SG_LoadOut:     appendOut(entries, node, PAGEdge::Load); break;
+                case SG_StoreIn:     appendIn(entries, node, PAGEdge::Store); break;
+                case SG_CopyOut:     appendOut(entries, node, PAGEdge::Copy); break;
+                case SG_SelectOut:   appendGrouped(entries, pag, selectOut, id); break;
+                case SG_PhiOut:      appendGrouped(entries, pag, phiOut, id); break;
+                case SG_Real2Formal: appendMapped(entries, pag, Real2Formal, id); break;
+                case SG_CallOut:     appendAdmissibleOut(entries, node, PAGEdge::Call); break;
+                case SG_Ret2Call:    appendMapped(entries, pag, Ret2Call, id); break;
+                case SG_RetOut:      appendAdmissibleOut(entries, node, PAGEdge::Ret); break;
+                case SG_CopyIn:      appendIn(entries, node, PAGEdge::Copy); break;
+                case SG_SelectIn:    appendGrouped(entries, pag, selectIn, id); break;
+                case SG_PhiIn:       appendGrouped(entries, pag, phiIn, id); break;
+                case SG_Formal2Real: appendMapped(entries, pag, Formal2Real, id); break;
+                case SG_CallIn:      appendAdmissibleIn(entries, node, PAGEdge::Call); break;
+                case SG_Call2Ret:    appendMapped(entries, pag, Call2Ret, id); break;
+                case SG_RetIn:       appendAdmissibleIn(entries, node, PAGEdge::Ret); break;
+                case SG_StoreOut:    appendOut(entries, node, PAGEdge::Store); break;
+                case SG_LoadIn:      appendIn(entries, node, PAGEdge::Load); break;
+                case SG_GepIn:       appendIn(entries, node, PAGEdge::Gep); break;
+                case SG_GepOut:      appendOut(entries, node, PAGEdge::Gep); break;
+            }
+            if(entries.size() != before){
+                masks[id] |= 1u << g;
+                groupEnds.push_back(snapIndex(entries.size()));
+            }
+        }
+    }
+    entries.shrink_to_fit();
+    groupEnds.shrink_to_fit();
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[initialize] Finish PAGSnapshot! nodes " << bound << ", entries " << entries.size()
+           << ", memory " << memoryBytes() / 1024 / 1024 << "MB, " << ms << "ms\n";
+}
+
+size_t PAGSnapshot::memoryBytes() const{
+    return nodes.capacity() * sizeof(PAGNode*) + masks.capacity() * sizeof(u32_t)
+        + groupStart.capacity() * sizeof(u32_t) + groupEnds.capacity() * sizeof(u32_t)
+        + entries.capacity() * sizeof(SnapEdge);
+}
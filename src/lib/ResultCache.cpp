@@ -0,0 +1,395 @@
+#include "../include/ResultCache.hpp"
+#include "../include/Incremental.hpp"
+#include "../include/PAGSnapshot.hpp"
+#include "../include/ShortcutIndex.hpp"
+#include "../include/UtilLLVM.hpp"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+static const char RESULT_CACHE_GV_MAGIC[8] = {'U', 'N', 'I', 'A', 'S', 'R', 'C', 'G'};
+static const char RESULT_CACHE_RES_MAGIC[8] = {'U', 'N', 'I', 'A', 'S', 'R', 'C', 'R'};
+static const u64_t RESULT_CACHE_END = 0x444e4548434143ull; // 文件尾标记，防止读到写了一半的文件。
+#define SIG_UNCACHEABLE 1 // 签名表中0表示还没有计算。
+
+static inline u64_t hashString(const string &str){
+    return hashBytes(str.data(), str.size());
+}
+
+static bool checkMagic(BinaryReader &r, const char (&magic)[8]){
+    char buf[8];
+    r.take(buf, sizeof(buf));
+    return r.ok && memcmp(buf, magic, sizeof(buf)) == 0 && r.get<u32_t>() == RESULT_CACHE_VERSION;
+}
+
+bool ResultCache::open(const string &dir, u64_t configKey){
+    if(access(dir.c_str(), W_OK) != 0){
+        errs() << "[ResultCache] Cannot write " << dir << ", result cache disabled\n";
+        return false;
+    }
+    this->dir = dir;
+    this->configKey = configKey;
+    return true;
+}
+
+// 节点标签 = hash(所属函数/全局变量, 节点类型, 同一所属、同一类型的节点中按NodeID的序号)。
+// 局部符号的名字前加上源文件名，避免不同模块里同名的static函数混在一起。
+// 不属于任何函数/全局变量的节点按类型和全局序号编号，其他地方增删节点时会变，只影响命中率。
+void ResultCache::buildLabels(){
+    auto start = std::chrono::steady_clock::now();
+    const NodeID num = pagSnapshot.numNodes();
+    labels.assign(num, NO_LABEL);
+    label2Node.clear();
+    unordered_map<const llvm::GlobalValue*, u64_t> ownerHashes;
+    unordered_map<u64_t, u32_t> ordinals; // (所属, 节点类型) -> 已分配的序号数。
+    unordered_set<u64_t> duplicated;
+    for(NodeID id = 0; id < num; id++){
+        PAGNode* node = pagSnapshot.getNode(id);
+        if(!node){
+            continue;
+        }
+        u64_t ownerHash = 0;
+        if(auto owner = getNodeOwner(node)){
+            auto it = ownerHashes.find(owner);
+            if(it == ownerHashes.end()){
+                string name = owner->getName().str();
+                if(owner->hasLocalLinkage() && owner->getParent()){
+                    name = owner->getParent()->getSourceFileName() + ":" + name;
+                }
+                it = ownerHashes.emplace(owner, hashString(name)).first;
+            }
+            ownerHash = it->second;
+        }
+        u64_t key[3] = {ownerHash, (u64_t)node->getNodeKind(), 0};
+        key[2] = ordinals[hashBytes(key, 2 * sizeof(u64_t))]++;
+        u64_t label = hashBytes(key, sizeof(key));
+        if(label == NO_LABEL){
+            label = 1;
+        }
+        labels[id] = label;
+        if(!label2Node.emplace(label, id).second){
+            duplicated.insert(label);
+        }
+    }
+    for(NodeID id = 0; id < num; id++){
+        if(duplicated.count(labels[id])){
+            labels[id] = NO_LABEL;
+        }
+    }
+    for(u64_t label : duplicated){
+        label2Node.erase(label);
+    }
+    signatures.reset(new std::atomic<u64_t>[num]());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[ResultCache] " << label2Node.size() << " node labels, " << duplicated.size() << " ambiguous, "
+           << ownerHashes.size() << " owners, " << ms << "ms\n";
+}
+
+// 节点签名：ComputeAlias在这个节点上读到的全部输入。引用到的节点没有唯一标签时返回SIG_UNCACHEABLE。
+// Cast site的两端按结构体名比较，这里记结构体名而不是StructID，StructID在不同的运行之间不稳定。
+u64_t ResultCache::computeSignature(NodeID id) const{
+    vector<u64_t> buf;
+    bool ok = true;
+    auto label = [&](NodeID n){
+        const u64_t l = getLabel(n);
+        ok &= l != NO_LABEL;
+        return l;
+    };
+    auto structName = [](StructID stID){
+        return stID < structNames.size() ? hashString(structNames[stID]) : (u64_t)INVALID_STRUCT_ID;
+    };
+    auto putNode = [&](const PAGNode* node){
+        buf.push_back(label(node->getId()));
+        buf.push_back(isBlackNode(node->getId()));
+    };
+    // visitedEdges按边判重，边用(类型, 两端)表示。Phi/Select的src端可能为空。
+    auto putEdge = [&](const PAGEdge* edge){
+        if(!edge){
+            buf.push_back(0);
+            return;
+        }
+        buf.push_back(edge->getEdgeKind() + 1);
+        buf.push_back(edge->getSrcNode() ? label(edge->getSrcID()) : 0);
+        buf.push_back(edge->getDstNode() ? label(edge->getDstID()) : 0);
+    };
+
+    buf.push_back(label(id));
+    buf.push_back(isBlackNode(id));
+    buf.push_back(structName(getNodeStructID(id)));
+    for(u32_t g = 0; g < SG_Num; g++){
+        const auto range = pagSnapshot.get(id, (SnapGroup)g);
+        if(range.empty()){
+            continue;
+        }
+        buf.push_back(g);
+        buf.push_back(range.size());
+        for(auto &se : range){
+            putNode(se.nbr);
+            putEdge(se.edge);
+            if(g != SG_GepIn && g != SG_GepOut){
+                continue;
+            }
+            const GepInfo* info = getGepInfo(se.edge);
+            if(!info){
+                buf.push_back(0);
+                continue;
+            }
+            buf.push_back(info->flags);
+            buf.push_back(info->offset);
+            buf.push_back(structName(info->stID));
+            if(g != SG_GepIn || (info->flags & GEP_VARIANT) || !(info->flags & GEP_TYPEBASED_SC)){
+                continue;
+            }
+            // 这条反向GEP边能走的shortcuts。
+            for(auto range : {shortcutIndex.typebased(info->stID, info->offset), shortcutIndex.additional(info->stID, info->offset)}){
+                buf.push_back(range.size());
+                for(auto edge : range){
+                    putEdge(edge);
+                    putNode(edge->getDstNode());
+                }
+            }
+            if(info->flags & GEP_CASTSITE_SC){
+                const auto castRange = shortcutIndex.castSites(info->stID);
+                buf.push_back(castRange.size());
+                for(auto edge : castRange){
+                    putEdge(edge);
+                    putNode(edge->getSrcNode());
+                    putNode(edge->getDstNode());
+                    buf.push_back(structName(getNodeStructID(edge->getSrcID())));
+                    buf.push_back(structName(getNodeStructID(edge->getDstID())));
+                }
+            }
+        }
+    }
+
+    // checkIfProtectable读到的Store所在函数，与Store边的顺序无关。
+    // 从快照取Store边：SVF的getIncomingEdges在没有该类边时会往节点的map里插入空集合，
+    // InitCache命中时getBlackNodes没有跑过，这些集合不一定已经存在，worker并发调用会写坏map。
+    vector<pair<u64_t, bool>> stores;
+    for(auto &se : pagSnapshot.get(id, SG_StoreIn)){
+        if(auto func = getStoreFunction(se.edge)){
+            stores.emplace_back(hashString(func->getName().str()), isInitFunction(func));
+        }
+    }
+    std::sort(stores.begin(), stores.end());
+    stores.erase(std::unique(stores.begin(), stores.end()), stores.end());
+    buf.push_back(stores.size());
+    for(auto &store : stores){
+        buf.push_back(store.first);
+        buf.push_back(store.second);
+    }
+    if(!ok){
+        return SIG_UNCACHEABLE;
+    }
+    const u64_t sig = hashBytes(buf.data(), buf.size() * sizeof(u64_t));
+    return sig > SIG_UNCACHEABLE ? sig : SIG_UNCACHEABLE + 1;
+}
+
+// 签名只读快照和initialize()建好的各表，对SVF的节点、边只调用不会改动它们的接口（见computeSignature中的Store边），
+// 多个worker同时计算同一个节点时结果相同，谁先写都可以。
+u64_t ResultCache::signature(NodeID id){
+    u64_t sig = signatures[id].load(std::memory_order_relaxed);
+    if(sig == 0){
+        sig = computeSignature(id);
+        signatures[id].store(sig, std::memory_order_relaxed);
+    }
+    return sig;
+}
+
+// 子图指纹，含有不能缓存的节点时返回0。
+u64_t ResultCache::fingerprint(const vector<NodeID> &entered){
+    vector<u64_t> buf;
+    buf.reserve(entered.size() + 1);
+    buf.push_back(configKey);
+    for(NodeID id : entered){
+        const u64_t sig = signature(id);
+        if(sig == SIG_UNCACHEABLE){
+            return 0;
+        }
+        buf.push_back(sig);
+    }
+    const u64_t fp = hashBytes(buf.data(), buf.size() * sizeof(u64_t));
+    return fp ? fp : 1;
+}
+
+string ResultCache::gvPath(const string &gv) const{
+    u64_t key[2] = {configKey, hashString(gv)};
+    char name[64];
+    snprintf(name, sizeof(name), "unias-rc-gv-%016llx.bin", (unsigned long long)hashBytes(key, sizeof(key)));
+    return dir + "/" + name;
+}
+
+string ResultCache::resultPath(u64_t fp) const{
+    char name[64];
+    snprintf(name, sizeof(name), "unias-rc-res-%016llx.bin", (unsigned long long)fp);
+    return dir + "/" + name;
+}
+
+// GV记录中的一个子图。
+struct CachedSubgraph {
+    u64_t fingerprint;
+    vector<u64_t> labels; // 按进入顺序。
+};
+
+static bool readGVRecord(const string &path, const string &gv, u64_t configKey, vector<CachedSubgraph> &subgraphs){
+    string buf;
+    if(!readWholeFile(path, buf)){
+        return false;
+    }
+    BinaryReader r(buf);
+    if(!checkMagic(r, RESULT_CACHE_GV_MAGIC) || r.get<u64_t>() != configKey || r.getString() != gv){
+        return false;
+    }
+    const u32_t num = r.get<u32_t>();
+    for(u32_t i = 0; i < num && i < RESULT_CACHE_WAYS && r.ok; i++){
+        CachedSubgraph subgraph;
+        subgraph.fingerprint = r.get<u64_t>();
+        const u32_t size = r.get<u32_t>();
+        if(size > buf.size() / sizeof(u64_t)){
+            return false;
+        }
+        subgraph.labels.resize(size);
+        for(auto &label : subgraph.labels){
+            label = r.get<u64_t>();
+        }
+        subgraphs.push_back(std::move(subgraph));
+    }
+    if(!r.atEnd(RESULT_CACHE_END)){
+        subgraphs.clear();
+        return false;
+    }
+    return true;
+}
+
+static bool readResult(const string &path, u64_t fp, GVResult &result){
+    string buf;
+    if(!readWholeFile(path, buf)){
+        return false;
+    }
+    BinaryReader r(buf);
+    if(!checkMagic(r, RESULT_CACHE_RES_MAGIC) || r.get<u64_t>() != fp){
+        return false;
+    }
+    result.truncated = TruncNone;
+    result.steps = r.get<u64_t>();
+    const u32_t num = r.get<u32_t>();
+    if(num > buf.size()){
+        return false;
+    }
+    result.fields.resize(num);
+    for(auto &field : result.fields){
+        field.offset = r.get<s64_t>();
+        field.aliases = r.get<u32_t>();
+        field.protectable = r.get<u8_t>();
+    }
+    return r.atEnd(RESULT_CACHE_END);
+}
+
+bool ResultCache::lookup(const string &gv, NodeID start, GVResult &result, vector<NodeID> &entered){
+    auto begin = std::chrono::steady_clock::now();
+    vector<CachedSubgraph> subgraphs;
+    if(!readGVRecord(gvPath(gv), gv, configKey, subgraphs)){
+        misses++;
+        return false;
+    }
+    for(const auto &subgraph : subgraphs){
+        entered.clear();
+        for(u64_t label : subgraph.labels){
+            auto it = label2Node.find(label);
+            if(it == label2Node.end()){
+                break;
+            }
+            entered.push_back(it->second);
+        }
+        if(entered.size() != subgraph.labels.size() || entered.empty() || entered.front() != start
+            || fingerprint(entered) != subgraph.fingerprint){
+            continue;
+        }
+        if(readResult(resultPath(subgraph.fingerprint), subgraph.fingerprint, result)){
+            result.gv = gv;
+            result.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+            hits++;
+            return true;
+        }
+    }
+    entered.clear();
+    stale++;
+    return false;
+}
+
+void ResultCache::store(const string &gv, const vector<NodeID> &entered, const GVResult &result){
+    if(result.truncated != TruncNone || entered.empty()){
+        return;
+    }
+    const u64_t fp = fingerprint(entered);
+    if(!fp){
+        skipped++;
+        return;
+    }
+    // 结果按指纹存放，已经有了就不再写。
+    const string resPath = resultPath(fp);
+    if(access(resPath.c_str(), F_OK) != 0){
+        BinaryWriter w;
+        w.put(RESULT_CACHE_RES_MAGIC);
+        w.put((u32_t)RESULT_CACHE_VERSION);
+        w.put(fp);
+        w.put(result.steps);
+        w.put((u32_t)result.fields.size());
+        for(const auto &field : result.fields){
+            w.put((s64_t)field.offset);
+            w.put(field.aliases);
+            w.put((u8_t)field.protectable);
+        }
+        w.put(RESULT_CACHE_END);
+        if(!writeFileAtomically(resPath, w.buf)){
+            errs() << "[ResultCache] Fail to write " << resPath << "\n";
+            return;
+        }
+    }
+
+    // 新的子图放在最前面，超出RESULT_CACHE_WAYS时丢掉最旧的。
+    const string path = gvPath(gv);
+    vector<CachedSubgraph> subgraphs;
+    readGVRecord(path, gv, configKey, subgraphs);
+    subgraphs.erase(std::remove_if(subgraphs.begin(), subgraphs.end(),
+                                   [fp](const CachedSubgraph &s){ return s.fingerprint == fp; }), subgraphs.end());
+    CachedSubgraph current;
+    current.fingerprint = fp;
+    for(NodeID id : entered){
+        current.labels.push_back(getLabel(id));
+    }
+    subgraphs.insert(subgraphs.begin(), std::move(current));
+    if(subgraphs.size() > RESULT_CACHE_WAYS){
+        subgraphs.resize(RESULT_CACHE_WAYS);
+    }
+    BinaryWriter w;
+    w.put(RESULT_CACHE_GV_MAGIC);
+    w.put((u32_t)RESULT_CACHE_VERSION);
+    w.put(configKey);
+    w.putString(gv);
+    w.put((u32_t)subgraphs.size());
+    for(const auto &subgraph : subgraphs){
+        w.put(subgraph.fingerprint);
+        w.put((u32_t)subgraph.labels.size());
+        for(u64_t label : subgraph.labels){
+            w.put(label);
+        }
+    }
+    w.put(RESULT_CACHE_END);
+    if(!writeFileAtomically(path, w.buf)){
+        errs() << "[ResultCache] Fail to write " << path << "\n";
+        return;
+    }
+    stores++;
+}
+
+void ResultCache::printStats() const{
+    if(!isOpen()){
+        return;
+    }
+    errs() << "[ResultCache] hits " << hits << ", misses " << misses << ", stale " << stale << ", stored " << stores
+           << ", uncacheable " << skipped << "\n";
+}
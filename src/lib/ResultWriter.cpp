@@ -0,0 +1,187 @@
+#include "../include/ResultWriter.hpp"
+#include <algorithm>
+#include <chrono>
+#include "llvm/Support/raw_ostream.h"
+
+static void appendRecord(string &buf, const string &escapedName, const GVResult &res){
+    u64_t aliasNodes = 0;
+    u32_t protectable = 0;
+    string fields;
+    for(const auto &field : res.fields){
+        aliasNodes += field.aliases;
+        protectable += field.protectable;
+        fields += (fields.empty() ? "{\"offset\":" : ",{\"offset\":") + std::to_string(field.offset)
+                  + ",\"aliases\":" + std::to_string(field.aliases)
+                  + ",\"protect\":" + (field.protectable ? "true}" : "false}");
+    }
+    buf += "{\"gv\":\"" + escapedName + "\",\"truncated\":\"" + truncReasonName(res.truncated)
+           + "\",\"time_us\":" + std::to_string(res.timeUs) + ",\"steps\":" + std::to_string(res.steps)
+           + ",\"offsets\":" + std::to_string(res.fields.size()) + ",\"protectable\":" + std::to_string(protectable)
+           + ",\"alias_nodes\":" + std::to_string(aliasNodes) + ",\"fields\":[" + fields + "]}\n";
+}
+
+bool ResultWriter::open(const string &path, size_t queueCap){
+    close();
+    fout.open(path, ios::out | ios::trunc | ios::binary);
+    if(!fout.is_open()){
+        errs() << "[ResultWriter] Fail to open " << path << "\n";
+        return false;
+    }
+    capacity = queueCap ? queueCap : 1;
+    stopping = false;
+    maxDepth = stalls = stallUs = 0;
+    written = 0;
+    index.clear();
+    writer = std::thread([this] { writerLoop(); });
+    return true;
+}
+
+void ResultWriter::close(){
+    if(!isOpen()){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    writer.join();
+    const u64_t recordBytes = written;
+    writeIndex();
+    fout.close();
+    errs() << "[ResultWriter] " << index.size() << " records, " << recordBytes / 1024 << "KB + index "
+           << (written - recordBytes) / 1024 << "KB, max queue depth " << maxDepth << "/" << capacity
+           << ", worker stalls " << stalls << " (" << stallUs / 1000 << "ms)\n";
+}
+
+// 只在队列满时等待writer线程，写盘本身不会阻塞worker。
+void ResultWriter::submit(GVResult &&result){
+    if(!isOpen()){
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if(queue.size() >= capacity){
+            auto start = std::chrono::steady_clock::now();
+            notFull.wait(lock, [this] { return queue.size() < capacity; });
+            stalls++;
+            stallUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        queue.push_back(std::move(result));
+        maxDepth = std::max<u64_t>(maxDepth, queue.size());
+    }
+    notEmpty.notify_one();
+}
+
+// 每次把队列整个取走，在锁外序列化，一批只写一次。
+void ResultWriter::writerLoop(){
+    std::deque<GVResult> batch;
+    string buf;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            notEmpty.wait(lock, [this] { return stopping || !queue.empty(); });
+            if(queue.empty()){
+                break;
+            }
+            batch.swap(queue);
+        }
+        notFull.notify_all();
+        for(const auto &res : batch){
+            const size_t begin = buf.size();
+            string name = jsonEscape(res.gv);
+            if(res.record.empty()){
+                appendRecord(buf, name, res);
+            }else{
+                buf += res.record;
+                buf += '\n';
+            }
+            index.push_back(ResultIndexEntry{std::move(name), written + begin, (u32_t)(buf.size() - begin)});
+        }
+        fout.write(buf.data(), buf.size());
+        written += buf.size();
+        buf.clear();
+        batch.clear();
+    }
+}
+
+void ResultWriter::writeIndex(){
+    std::stable_sort(index.begin(), index.end(), [](const ResultIndexEntry &a, const ResultIndexEntry &b) { return a.gv < b.gv; });
+    const u64_t indexOffset = written;
+    string buf;
+    for(const auto &entry : index){
+        buf += "{\"gv\":\"" + entry.gv + "\",\"offset\":" + std::to_string(entry.offset)
+               + ",\"length\":" + std::to_string(entry.length) + "}\n";
+    }
+    char trailer[RESULT_TRAILER_SIZE + 1];
+    snprintf(trailer, sizeof(trailer), "{\"index_offset\":%20llu,\"records\":%12llu}\n",
+             (unsigned long long)indexOffset, (unsigned long long)index.size());
+    buf += trailer;
+    fout.write(buf.data(), buf.size());
+    written += buf.size();
+}
+
+bool ResultReader::open(const string &path){
+    index.clear();
+    fin.close();
+    fin.clear();
+    fin.open(path, ios::in | ios::binary);
+    if(!fin.is_open()){
+        return false;
+    }
+    fin.seekg(0, ios::end);
+    const u64_t size = fin.tellg();
+    if(size < RESULT_TRAILER_SIZE){
+        return false;
+    }
+    char trailer[RESULT_TRAILER_SIZE + 1] = {};
+    fin.seekg(size - RESULT_TRAILER_SIZE);
+    fin.read(trailer, RESULT_TRAILER_SIZE);
+    unsigned long long indexOffset = 0, numRecords = 0;
+    if(!fin || sscanf(trailer, "{\"index_offset\":%llu,\"records\":%llu}", &indexOffset, &numRecords) != 2
+        || indexOffset > size - RESULT_TRAILER_SIZE){
+        return false;
+    }
+    // 转义后的名字里不会出现未转义的引号，所以从行尾往前找","offset":即可。
+    static const string sep = "\",\"offset\":";
+    fin.seekg(indexOffset);
+    string line;
+    for(u64_t i = 0; i < numRecords; i++){
+        unsigned long long offset = 0;
+        unsigned length = 0;
+        size_t pos;
+        if(!std::getline(fin, line) || line.compare(0, 7, "{\"gv\":\"") != 0 || (pos = line.rfind(sep)) == string::npos || pos < 7
+            || sscanf(line.c_str() + pos + sep.size(), "%llu,\"length\":%u}", &offset, &length) != 2){
+            index.clear();
+            return false;
+        }
+        index.push_back(ResultIndexEntry{line.substr(7, pos - 7), offset, length});
+    }
+    return true;
+}
+
+bool ResultReader::read(const string &gv, vector<string> &records){
+    records.clear();
+    const string name = jsonEscape(gv);
+    auto it = std::lower_bound(index.begin(), index.end(), name,
+                               [](const ResultIndexEntry &e, const string &n){ return e.gv < n; });
+    for(; it != index.end() && it->gv == name; ++it){
+        string record(it->length, '\0');
+        fin.clear();
+        fin.seekg(it->offset);
+        if(!fin.read(&record[0], it->length)){
+            return false;
+        }
+        if(!record.empty() && record.back() == '\n'){
+            record.pop_back();
+        }
+        records.push_back(std::move(record));
+    }
+    return true;
+}
+
+bool lookupResults(const string &path, const string &gv, vector<string> &records){
+    ResultReader reader;
+    records.clear();
+    return reader.open(path) && reader.read(gv, records);
+}
@@ -0,0 +1,120 @@
+#include "../include/ShortcutCache.hpp"
+#include "llvm/Support/raw_ostream.h"
+
+ShortcutCache::ShortcutCache(size_t capBytes, u64_t maxSteps, u32_t shardNum)
+    : shards(shardNum ? shardNum : 1), capBytes(capBytes), maxSteps(maxSteps), hits(0), misses(0), shallowMisses(0),
+      inserts(0), tooLargeKeys(0), full(0), splicedAliases(0), expandUs(0), totalBytes(0) {
+}
+
+// 粗略估计：key、结果本体和hash表节点的开销。
+static size_t entryBytes(const ShortcutKey &key, const TraversalSummary* summary) {
+    return sizeof(ShortcutKey) + key.stack.size() * sizeof(s64_t) + 64
+        + (summary ? sizeof(TraversalSummary) + summary->aliases.size() * sizeof(pair<s64_t, PAGNode*>) : 0);
+}
+
+// 先加再检查，超出上限时退回，并发插入时总量也不会越过capBytes。
+bool ShortcutCache::reserve(size_t bytes) {
+    if (totalBytes.fetch_add(bytes) + bytes > capBytes) {
+        totalBytes -= bytes;
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<const TraversalSummary> ShortcutCache::lookup(const ShortcutKey &key, u32_t depth, bool &tooLarge) {
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    tooLarge = false;
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        misses++;
+        return nullptr;
+    }
+    if (it->second.tooLarge) {
+        tooLarge = true;
+        return nullptr;
+    }
+    if (!it->second.summary->validAt(depth)) {
+        shallowMisses++;
+        return nullptr;
+    }
+    hits++;
+    return it->second.summary;
+}
+
+void ShortcutCache::insert(ShortcutKey &&key, TraversalSummary &&summary) {
+    const size_t bytes = entryBytes(key, &summary);
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        // 已有结果时，只在新结果适用的深度范围更大时替换，规则同SummaryCache::insert。
+        if (it->second.tooLarge) {
+            return;
+        }
+        const auto &cur = *it->second.summary;
+        bool better = (cur.depthCut && !summary.depthCut)
+            || (cur.depthCut == summary.depthCut && summary.depth < cur.depth);
+        if (!better) {
+            return;
+        }
+        // 只为增加的部分占用额度。
+        if (bytes > it->second.bytes && !reserve(bytes - it->second.bytes)) {
+            full++;
+            return;
+        }
+        if (bytes < it->second.bytes) {
+            totalBytes -= it->second.bytes - bytes;
+        }
+        it->second.summary = std::make_shared<const TraversalSummary>(std::move(summary));
+        it->second.bytes = bytes;
+    } else {
+        if (!reserve(bytes)) {
+            full++;
+            return;
+        }
+        auto &entry = shard.entries[std::move(key)];
+        entry.summary = std::make_shared<const TraversalSummary>(std::move(summary));
+        entry.tooLarge = false;
+        entry.bytes = bytes;
+    }
+    inserts++;
+}
+
+// 标记也占内存，同样受capBytes限制；满了时不记，之后的GV会再展开一次并再次超过maxSteps。
+void ShortcutCache::markTooLarge(ShortcutKey &&key) {
+    const size_t bytes = entryBytes(key, nullptr);
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        if (!reserve(bytes)) {
+            full++;
+            return;
+        }
+        auto &entry = shard.entries[std::move(key)];
+        entry.tooLarge = true;
+        entry.bytes = bytes;
+        tooLargeKeys++;
+        return;
+    }
+    auto &entry = it->second;
+    if (entry.tooLarge) {
+        return;
+    }
+    // 标记比原来的结果小，直接替换并退回多出的额度。
+    entry.summary.reset();
+    entry.tooLarge = true;
+    totalBytes -= entry.bytes - bytes;
+    entry.bytes = bytes;
+    tooLargeKeys++;
+}
+
+void ShortcutCache::printStats() const {
+    u64_t lookups = hits + misses + shallowMisses;
+    errs() << "[ShortcutCache] lookups " << lookups << ", hits " << hits
+           << " (" << (lookups ? hits * 100 / lookups : 0) << "%), misses " << misses
+           << ", shallow misses " << shallowMisses << ", inserts " << inserts
+           << ", too large " << tooLargeKeys << ", full " << full << ", spliced aliases " << splicedAliases
+           << ", expand " << expandUs / 1000 << "ms, memory " << totalBytes / 1024 << "KB\n";
+}
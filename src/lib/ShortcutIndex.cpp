@@ -0,0 +1,102 @@
+#include "../include/ShortcutIndex.hpp"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+
+ShortcutIndex shortcutIndex;
+
+// [initialize] 必须在finalizeGepInfos之后、分析开始之前调用，此后原来的三张表的修改不会反映到索引中。
+void ShortcutIndex::build(){
+    auto start = std::chrono::steady_clock::now();
+    StructID bound = 0;
+    for(auto &st : typebasedShortcuts){
+        bound = std::max(bound, st.first + 1);
+    }
+    for(auto &st : additionalShortcuts){
+        bound = std::max(bound, st.first + 1);
+    }
+    for(auto &st : ::castSites){
+        bound = std::max(bound, st.first + 1);
+    }
+    stStart.assign(bound + 1, 0);
+    castStart.assign(bound + 1, 0);
+    entries.clear();
+    edges.clear();
+    castEdges.clear();
+
+    u64_t droppedAdditional = 0;
+    for(StructID stID = 0; stID < bound; stID++){
+        stStart[stID] = entries.size();
+        castStart[stID] = castEdges.size();
+
+        auto typebasedIt = typebasedShortcuts.find(stID);
+        auto additionalIt = additionalShortcuts.find(stID);
+        vector<u32_t> offsets;
+        if(typebasedIt != typebasedShortcuts.end()){
+            for(auto &off : typebasedIt->second){
+                offsets.push_back(off.first);
+            }
+        }
+        if(additionalIt != additionalShortcuts.end()){
+            for(auto &off : additionalIt->second){
+                offsets.push_back(off.first);
+            }
+        }
+        std::sort(offsets.begin(), offsets.end());
+        offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+        for(auto offset : offsets){
+            OffsetEntry entry;
+            entry.offset = offset;
+            entry.begin = edges.size();
+            unordered_set<PAGNode*> visitedShortcuts;
+            if(typebasedIt != typebasedShortcuts.end()){
+                auto offsetIt = typebasedIt->second.find(offset);
+                if(offsetIt != typebasedIt->second.end()){
+                    for(auto dstShort : offsetIt->second){
+                        edges.push_back(dstShort);
+                        visitedShortcuts.insert(dstShort->getDstNode());
+                    }
+                }
+            }
+            entry.mid = edges.size();
+            if(additionalIt != additionalShortcuts.end()){
+                auto offsetIt = additionalIt->second.find(offset);
+                if(offsetIt != additionalIt->second.end()){
+                    for(auto dstSet : offsetIt->second){
+                        for(auto dstShort : *dstSet){
+                            if(visitedShortcuts.insert(dstShort->getDstNode()).second){
+                                edges.push_back(dstShort);
+                            }else{
+                                droppedAdditional++;
+                            }
+                        }
+                    }
+                }
+            }
+            entry.end = edges.size();
+            entries.push_back(entry);
+        }
+
+        auto castIt = ::castSites.find(stID);
+        if(castIt != ::castSites.end()){
+            castEdges.insert(castEdges.end(), castIt->second.begin(), castIt->second.end());
+        }
+    }
+    stStart[bound] = entries.size();
+    castStart[bound] = castEdges.size();
+    assert(edges.size() < UINT32_MAX && entries.size() < UINT32_MAX && castEdges.size() < UINT32_MAX && "ShortcutIndex overflow");
+    entries.shrink_to_fit();
+    edges.shrink_to_fit();
+    castEdges.shrink_to_fit();
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[initialize] Finish ShortcutIndex! structs " << bound << ", (struct, offset) keys " << entries.size()
+           << ", shortcut edges " << edges.size() << " (duplicate additional dropped " << droppedAdditional
+           << "), cast sites " << castEdges.size() << ", memory " << memoryBytes() / 1024 << "KB, " << ms << "ms\n";
+}
+
+size_t ShortcutIndex::memoryBytes() const{
+    return stStart.capacity() * sizeof(u32_t) + entries.capacity() * sizeof(OffsetEntry)
+        + edges.capacity() * sizeof(PAGEdge*) + castStart.capacity() * sizeof(u32_t)
+        + castEdges.capacity() * sizeof(PAGEdge*);
+}
@@ -0,0 +1,65 @@
+#include "../include/StackPool.hpp"
+#include <algorithm>
+
+void StackPool::reset(){
+    if(slots.empty()){
+        slots.resize(STATE_TABLE_INIT_SLOTS, Slot{0, EMPTY_STACK_ID});
+    }
+    nextEpoch(epoch, slots);
+    cells.clear();
+    cells.push_back(Cell{0, EMPTY_STACK_ID});
+    used = 0;
+}
+
+StackID StackPool::push(StackID below, s64_t item){
+    if((used + 1) * 2 > slots.size()){
+        grow();
+    }
+    const size_t mask = slots.size() - 1;
+    for(size_t i = mix64(((u64_t)below << 32) ^ (u64_t)item) & mask;; i = (i + 1) & mask){
+        auto &slot = slots[i];
+        if(slot.stamp != epoch){
+            slot.stamp = epoch;
+            slot.id = cells.size();
+            cells.push_back(Cell{item, below});
+            used++;
+            return slot.id;
+        }
+        const auto &cell = cells[slot.id];
+        if(cell.below == below && cell.item == item){
+            return slot.id;
+        }
+    }
+}
+
+void StackPool::grow(){
+    vector<Slot> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, Slot{0, EMPTY_STACK_ID});
+    const size_t mask = slots.size() - 1;
+    for(auto &slot : old){
+        if(slot.stamp != epoch){
+            continue;
+        }
+        const auto &cell = cells[slot.id];
+        size_t i = mix64(((u64_t)cell.below << 32) ^ (u64_t)cell.item) & mask;
+        while(slots[i].stamp == epoch){
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
+bool VisitedStates::visit(NodeID node, StackID stack, bool state, bool taken, u32_t depth){
+    // 分析栈超出key的位数时不做去重。
+    if(stack >= MAX_STATE_STACK_ID){
+        return true;
+    }
+    bool inserted;
+    u32_t &seenDepth = table.get(packStateKey(node, stack, state, taken), inserted);
+    if(inserted || depth < seenDepth){
+        seenDepth = depth;
+        return true;
+    }
+    return false;
+}
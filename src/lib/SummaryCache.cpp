@@ -0,0 +1,89 @@
+#include "../include/SummaryCache.hpp"
+#include "llvm/Support/raw_ostream.h"
+
+SummaryCache::SummaryCache(size_t capBytes, u64_t minSteps, NodeID nodeBound, u32_t shardNum)
+    : shards(shardNum ? shardNum : 1), nodeBound(nodeBound), nodeBits(new std::atomic<u64_t>[nodeBound / 64 + 1]),
+      minSteps(minSteps), hits(0), misses(0), shallowMisses(0), inserts(0), evictions(0), splicedAliases(0), totalBytes(0) {
+    shardCap = capBytes / shards.size();
+    for (NodeID i = 0; i <= nodeBound / 64; i++) {
+        nodeBits[i] = 0;
+    }
+}
+
+size_t SummaryCache::entryBytes(const SummaryKey &key, const TraversalSummary &summary) {
+    // 粗略估计：key、摘要本体、hash表节点和LRU节点的开销。
+    return sizeof(SummaryKey) + key.stack.size() * sizeof(s64_t)
+        + sizeof(TraversalSummary) + summary.aliases.size() * sizeof(pair<s64_t, PAGNode*>)
+        + 64;
+}
+
+shared_ptr<const TraversalSummary> SummaryCache::lookup(const SummaryKey &key, u32_t depth) {
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        misses++;
+        return nullptr;
+    }
+    if (!it->second.summary->validAt(depth)) {
+        shallowMisses++;
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruIt);
+    hits++;
+    return it->second.summary;
+}
+
+void SummaryCache::insert(SummaryKey &&key, TraversalSummary &&summary) {
+    auto &shard = getShard(key);
+    size_t bytes = entryBytes(key, summary);
+    if (bytes > shardCap) {
+        return;
+    }
+    if (key.node < nodeBound) {
+        nodeBits[key.node / 64].fetch_or(1ull << (key.node % 64), std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        // 已有摘要时，只在新摘要适用的深度范围更大时替换。
+        const auto &cur = *it->second.summary;
+        bool better = (cur.depthCut && !summary.depthCut)
+            || (cur.depthCut == summary.depthCut && summary.depth < cur.depth);
+        if (!better) {
+            return;
+        }
+        shard.bytes -= it->second.bytes;
+        totalBytes -= it->second.bytes;
+        it->second.summary = std::make_shared<const TraversalSummary>(std::move(summary));
+        it->second.bytes = bytes;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruIt);
+    } else {
+        auto res = shard.entries.emplace(std::move(key), Entry());
+        auto &entry = res.first->second;
+        entry.summary = std::make_shared<const TraversalSummary>(std::move(summary));
+        entry.bytes = bytes;
+        shard.lru.push_front(&res.first->first);
+        entry.lruIt = shard.lru.begin();
+    }
+    shard.bytes += bytes;
+    totalBytes += bytes;
+    inserts++;
+    while (shard.bytes > shardCap && !shard.lru.empty()) {
+        auto victim = shard.entries.find(*shard.lru.back());
+        shard.bytes -= victim->second.bytes;
+        totalBytes -= victim->second.bytes;
+        shard.lru.pop_back();
+        shard.entries.erase(victim);
+        evictions++;
+    }
+}
+
+void SummaryCache::printStats() const {
+    u64_t lookups = hits + misses + shallowMisses;
+    errs() << "[SummaryCache] lookups " << lookups << ", hits " << hits
+           << " (" << (lookups ? hits * 100 / lookups : 0) << "%), misses " << misses
+           << ", shallow misses " << shallowMisses << ", inserts " << inserts
+           << ", evictions " << evictions << ", spliced aliases " << splicedAliases
+           << ", memory " << totalBytes / 1024 << "KB\n";
+}
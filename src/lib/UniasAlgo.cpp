@@ -1,381 +1,810 @@
 #include "../include/UniasAlgo.hpp"
+#include <algorithm>
+#include <chrono>
 
-bool UniasAlgo::ifValidForTypebasedShortcut(PAGEdge* edge, u32_t threshold){
-    if(edge->getSrcNode()->getType()){
-        if(auto sttype = ifPointToStruct(edge->getSrcNode()->getType())){
-            auto offset = gep2byteoffset[edge];
-            // 核心在于结构体类型和offset要能在typebasedShortcuts中匹配到。
-            if(typebasedShortcuts.find(getStructName(sttype)) != typebasedShortcuts.end()
-                && typebasedShortcuts[getStructName(sttype)].find(offset) != typebasedShortcuts[getStructName(sttype)].end()
-                && typebasedShortcuts[getStructName(sttype)][offset].size() < threshold
-            ){
-                return true;
-            }
+// epoch加一。回绕到0时返回true，调用方需要把对应的stamp清零，避免旧表项与新的epoch相同。
+static bool nextEpoch(u32_t &epoch){
+    if(++epoch != 0){
+        return false;
+    }
+    epoch = 1;
+    return true;
+}
+
+void AliasWorkspace::begin(NodeID bound){
+    if(icallStamp.size() < bound){
+        icallStamp.resize(bound, 0);
+        dynBlackStamp.resize(bound, 0);
+        freqStamp.resize(bound, 0);
+        freq.resize(bound, 0);
+        aliasStamp.resize(bound, 0);
+        aliasOffset.resize(bound, 0);
+        enteredStamp.resize(bound, 0);
+    }
+    if(nextEpoch(epoch)){
+        std::fill(icallStamp.begin(), icallStamp.end(), 0);
+        std::fill(dynBlackStamp.begin(), dynBlackStamp.end(), 0);
+        std::fill(aliasStamp.begin(), aliasStamp.end(), 0);
+        std::fill(enteredStamp.begin(), enteredStamp.end(), 0);
+    }
+    dynBlackNum = 0;
+    enteredNodes.clear();
+    resetFreq();
+    stacks.reset();
+    states.reset();
+}
+
+void AliasWorkspace::resetFreq(){
+    if(nextEpoch(freqEpoch)){
+        std::fill(freqStamp.begin(), freqStamp.end(), 0);
+    }
+    touched.clear();
+}
+
+void AliasWorkspace::topFrequent(size_t k, vector<NodeID> &out){
+    out.clear();
+    sorted.clear();
+    for(auto id : touched){
+        sorted.emplace_back(freq[id], id);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                    [](const pair<u32_t, NodeID> &a, const pair<u32_t, NodeID> &b){ return a.first > b.first; });
+    for(size_t i = 0; i < k && i < sorted.size(); i++){
+        out.push_back(sorted[i].second);
+    }
+}
+
+void AliasWorkspace::swapBuffers(AliasTraversal &traversal){
+    traversal.frames.swap(buffers.frames);
+    traversal.steps.swap(buffers.steps);
+    traversal.aliasLog.swap(buffers.aliasLog);
+    traversal.pathEdges.swap(buffers.pathEdges);
+    traversal.pathIcalls.swap(buffers.pathIcalls);
+}
+
+void UniasAlgo::addStep(PAGNode* nxt, PAGEdge* eg, bool state, PAGNode* icall, StepOp op, PNwithOffset item, s64_t delta){
+    PropStep step;
+    step.nxt = nxt;
+    step.eg = eg;
+    step.icall = icall;
+    step.state = state;
+    step.op = op;
+    step.item = item;
+    step.delta = delta;
+    traversal.steps.push_back(step);
+}
+
+// Prop的前半部分：判断能否走向step.nxt，能则记录visited并对分析栈做进入前的操作。
+// eg的一边是上一层ComputeAlias的cur节点，另一边是待分析的nxt节点。其用来防止重复计算（只有过程间分析时调用Prop的eg==nullptr）。
+bool UniasAlgo::propEnter(const PropStep &step){
+    if(isBlackNode(step.nxt->getId())){
+        metrics.rejectBlack++;
+        return false;
+    }
+    if(workspace->numDynBlack() && workspace->isDynBlack(step.nxt->getId())){
+        metrics.rejectDynBlack++;
+        if(summaries){
+            markContextCut(nullptr, nullptr);
         }
+        return false;
     }
-    return false;
+    if(visitedEdges.size() > MAX_PATH_EDGES){
+        metrics.rejectEdgeCap++;
+        if(summaries){
+            traversal.frames.back().depthCut = true;
+        }
+        return false;
+    }
+    if(step.eg && !visitedEdges.insert(step.eg)){
+        metrics.rejectEdge++;
+        if(summaries){
+            markContextCut(step.eg, nullptr);
+        }
+        return false;
+    }
+    if(step.icall && !workspace->insertIcall(step.icall->getId())){
+        metrics.rejectIcall++;
+        if(step.eg){
+            visitedEdges.erase(step.eg);
+        }
+        if(summaries){
+            markContextCut(nullptr, step.icall);
+        }
+        return false;
+    }
+    switch(step.op){
+        case OpPop:
+            AnalysisStack.pop();
+            break;
+        case OpPush:
+            AnalysisStack.push(step.item);
+            break;
+        case OpOffset:
+            AnalysisStack.top().offset += step.delta;
+            break;
+        default:
+            break;
+    }
+    if(dedupStates){
+        switch(step.op){
+            case OpPop:
+                stackID = workspace->stacks.pop(stackID);
+                break;
+            case OpPush:
+                stackID = topStackID(stackID);
+                break;
+            case OpOffset:
+                stackID = topStackID(workspace->stacks.pop(stackID));
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
 }
 
-bool UniasAlgo::ifValidForCastSiteShortcut(PAGEdge* edge, u32_t threshold){
-    if(edge->getSrcNode()->getType()){
-        if(auto sttype = ifPointToStruct(edge->getSrcNode()->getType())){
-            // 核心在于结构体类型要能在castSites中匹配到。
-            if(castSites[getStructName(sttype)].size() < threshold){
-                return true;
+static inline s64_t packStackItem(const PNwithOffset &item){
+    return item.offset * 2 + (item.curFlow ? 1 : 0);
+}
+
+// 在below之上压入当前栈顶元素得到的StackID。
+StackID UniasAlgo::topStackID(StackID below) const{
+    return workspace->stacks.push(below, packStackItem(AnalysisStack.top()));
+}
+
+// Prop的后半部分：子节点分析结束，撤销propEnter对分析栈和visited集合的改动。
+void UniasAlgo::propLeave(const PropStep &step){
+    switch(step.op){
+        case OpPop:
+            AnalysisStack.push(step.item); // 压回进入前保存的栈顶副本。
+            break;
+        case OpPush:
+            AnalysisStack.pop();
+            break;
+        case OpOffset:
+            AnalysisStack.top().offset -= step.delta;
+            break;
+        default:
+            break;
+    }
+    if(step.icall){
+        workspace->eraseIcall(step.icall->getId());
+    }
+    if(step.eg){
+        visitedEdges.erase(step.eg);
+    }
+    if(dedupStates){
+        stackID = traversal.frames.back().stackID; // 分析栈恢复成父帧处理各step时的样子。
+    }
+}
+
+// aliasLog的长度上限。超过后放弃为当前所有未结束的帧生成摘要，清空日志。
+static const size_t SUMMARY_LOG_CAP = 1 << 20;
+
+void UniasAlgo::recordAlias(s64_t offset, PAGNode* node){
+    if(workspace->newAlias(node->getId(), offset)){
+        Aliases.insert(offset, node->getId());
+    }
+    if(!summaries){
+        return;
+    }
+    if(traversal.aliasLog.size() >= SUMMARY_LOG_CAP){
+        for(auto &frame : traversal.frames){
+            frame.logBegin = AliasFrame::NO_LOG;
+        }
+        traversal.aliasLog.clear();
+    }
+    traversal.aliasLog.emplace_back(offset, node);
+}
+
+// 遍历因路径上已有的eg/icall被拒绝时，找到用它进入的那一帧，从那一帧往下的结果都依赖这条路径。
+// eg和icall都为空表示拒绝原因与整条路径有关（动态黑名单），所有未结束的帧都不能做摘要。
+// 这里只更新栈顶帧的cutFrom，帧结束时再向父帧合并。
+void UniasAlgo::markContextCut(const PAGEdge* eg, const PAGNode* icall){
+    u32_t from = 0;
+    if(eg || icall){
+        for(size_t i = traversal.pathEdges.size(); i-- > 0;){
+            if((eg && traversal.pathEdges[i] == eg) || (icall && traversal.pathIcalls[i] == icall)){
+                from = i;
+                break;
             }
         }
     }
-    return false;
+    auto &top = traversal.frames.back();
+    top.cutFrom = std::min(top.cutFrom, from);
 }
 
-// Prop函数：本质上是对ComputeAlias的套壳，可管理工作队列、防止重复分析。
-// 功能上，是对PAG中的下一个节点进行Alias query的操作。
-// eg的一边是上一层ComputeAlias的cur节点，另一边是待分析的nxt节点。其用来防止重复计算（只有过程间分析时调用Prop的eg==nullptr）。
-void UniasAlgo::Prop(PAGNode* nxt, PAGEdge* eg, bool state, PAGNode* icall){
-    if(blackNodes.find(nxt->getId()) != blackNodes.end()){
-        return;
+// 用当前分析栈构造摘要key，栈底元素不进入key。
+void UniasAlgo::makeSummaryKey(PAGNode* node, bool state, SummaryKey &key) const{
+    key.node = node->getId();
+    key.state = state;
+    key.taken = taken;
+    const auto &items = AnalysisStack.items();
+    key.stack.clear();
+    key.stack.reserve(items.size() - 1);
+    for(auto it = std::next(items.begin()); it != items.end(); ++it){
+        key.stack.push_back(packStackItem(*it));
     }
-    if(visitedEdges.size() > 25){
-        return;
+}
+
+// 在propEnter成功之后、进入node之前查询摘要。命中则把摘要里的别名按当前栈底offset写回Aliases，不再遍历子树。
+// 注意这是近似：摘要是在另一条路径的visitedEdges/icall下算出来的，也不再累计节点的访问次数。
+bool UniasAlgo::spliceSummary(PAGNode* node, bool state){
+    if(!summaries->mayContain(node->getId())){
+        return false;
     }
-    if(eg && !visitedEdges.insert(eg).second){
-        return;
+    SummaryKey key;
+    makeSummaryKey(node, state, key);
+    const u32_t depth = visitedEdges.size();
+    auto summary = summaries->lookup(key, depth);
+    if(!summary){
+        return false;
+    }
+    // 拼接进来的子树也算作当前帧子树的一部分。
+    auto &frame = traversal.frames.back();
+    frame.maxDepth = std::max(frame.maxDepth, depth + summary->span);
+    frame.depthCut |= summary->depthCut;
+    const s64_t base = AnalysisStack.items().front().offset;
+    for(const auto &alias : summary->aliases){
+        recordAlias(base + alias.first, alias.second);
     }
-    if(icall && !visitedicalls.insert(icall).second){
+    summaries->addSpliced(summary->aliases.size());
+    return true;
+}
+
+// 帧结束时分析栈、taken、visitedEdges都已恢复成进入时的样子，此时把本帧期间的aliasLog整理成摘要。
+// 只有没被祖先路径剪过的子树才做摘要，这样摘要里的结果只由(节点, 分析栈, state, taken)和剩余深度决定。
+// 复用时仍是近似：当前路径上已走过的边如果也出现在子树里，原算法会剪掉，摘要则不会。
+void UniasAlgo::saveSummary(const AliasFrame &frame){
+    if(frame.cutFrom <= traversal.frames.size() - 1 || frame.logBegin == AliasFrame::NO_LOG
+        || traversal.stepsDone - frame.stepsAtEntry < summaries->getMinSteps()){
         return;
     }
-    ComputeAlias(nxt, state);
-    if(icall){
-        visitedicalls.erase(icall);
+    SummaryKey key;
+    makeSummaryKey(frame.node, frame.state, key);
+    TraversalSummary summary;
+    summary.depth = frame.entryDepth;
+    summary.span = frame.maxDepth - frame.entryDepth;
+    summary.depthCut = frame.depthCut;
+    const s64_t base = AnalysisStack.items().front().offset;
+    summary.aliases.reserve(traversal.aliasLog.size() - frame.logBegin);
+    for(auto i = frame.logBegin; i < traversal.aliasLog.size(); i++){
+        summary.aliases.emplace_back(traversal.aliasLog[i].first - base, traversal.aliasLog[i].second);
+    }
+    std::sort(summary.aliases.begin(), summary.aliases.end());
+    summary.aliases.erase(std::unique(summary.aliases.begin(), summary.aliases.end()), summary.aliases.end());
+    summaries->insert(std::move(key), std::move(summary));
+}
+
+// 反向GEP边走typebased shortcut时的各个step（不含OpSetTaken/OpClearTaken）。返回是否走了CastSite类型的shortcut。
+bool UniasAlgo::addShortcutSteps(const GepInfo* info){
+    bool castShortcutTaken = false;
+    const auto offset = info->offset;
+    const auto stID = info->stID; // GEP_TYPEBASED_SC已保证其有效。
+    // 处理Field-to-Field Shortcuts，并进行Prop。
+    const auto typebasedRange = shortcutIndex.typebased(stID, offset);
+    metrics.typebasedShortcuts += typebasedRange.size();
+    for(auto dstShort : typebasedRange){
+        addStep(dstShort->getDstNode(), dstShort, false, nullptr);
     }
-    if(eg){
-        visitedEdges.erase(eg);
+    // 处理Additional Shortcuts，并进行Prop。（Unias论文里似乎没提到这个）
+    // 冻结索引时已按dst节点去重，并去掉了上面typebased已到达的节点。
+    const auto additionalRange = shortcutIndex.additional(stID, offset);
+    metrics.additionalShortcuts += additionalRange.size();
+    for(auto dstShort : additionalRange){
+        addStep(dstShort->getDstNode(), dstShort, false, nullptr);
     }
+    // 处理Field-to-CastSite Shortcuts。
+    if(info->flags & GEP_CASTSITE_SC){
+        // 遍历所有符合类型的CastSites。每个dstCast都是一个Cast类型的PAGEdge*。
+        const auto castRange = shortcutIndex.castSites(stID);
+        metrics.castSiteShortcuts += castRange.size();
+        for(auto dstCast : castRange){
+            // Cast边的Src端是同一结构体时走向Dst端，否则走向Src端；Dst端同理。
+            // 节点类型不指向结构体时ID为INVALID_STRUCT_ID，必然与stID不同。
+            bool needVisitDst = false;
+            bool needVisitSrc = false;
+            if(getNodeStructID(dstCast->getSrcNode()->getId()) == stID){
+                needVisitDst = true;
+            }else{
+                needVisitSrc = true;
+            }
+            if(getNodeStructID(dstCast->getDstNode()->getId()) == stID){
+                needVisitSrc = true;
+            }else{
+                needVisitDst = true;
+            }
+            // 判断应该在Cast边的Src端还是Dest端进行Prop。
+            // 注意：前面两处走shortcut时都没有对topItem.offset进行修改，这里略有不同。
+            // 解释：需要先减去offset，是因为走Cast的shortcut过去后还要再匹配一条正向GEP边。
+            if(needVisitSrc){
+                addStep(dstCast->getSrcNode(), dstCast, true, nullptr, OpOffset, PNwithOffset(), -offset);
+            }
+            if(needVisitDst){
+                addStep(dstCast->getDstNode(), dstCast, false, nullptr, OpOffset, PNwithOffset(), -offset);
+            }
+        }
+        castShortcutTaken = true; // 表示CastSite类型的shortcut是可以处理的。
+    }
+    return castShortcutTaken;
+}
+
+// 开始一次只展开shortcut的遍历：第一帧不对应任何节点，它的step就是addShortcutSteps生成的各条shortcut。
+// 调用前已设置好分析栈和visitedEdges，taken为true，展开的子树里不会再走shortcut。
+void UniasAlgo::startShortcut(const GepInfo* info){
+    workspace->begin(pagSnapshot.numNodes());
+    workspace->swapBuffers(traversal);
+    taken = true;
+    stackID = EMPTY_STACK_ID;
+    if(dedupStates){
+        for(auto &item : AnalysisStack.items()){
+            stackID = workspace->stacks.push(stackID, packStackItem(item));
+        }
+    }
+    traversal.frames.clear();
+    traversal.steps.clear();
+    traversal.stepsDone = 0;
+    traversal.aliasLog.clear();
+    traversal.pathEdges.clear();
+    traversal.pathIcalls.clear();
+
+    AliasFrame frame;
+    frame.stepBegin = 0;
+    frame.cursor = 0;
+    frame.inChild = false;
+    frame.node = nullptr;
+    frame.state = false;
+    frame.logBegin = AliasFrame::NO_LOG;
+    frame.stepsAtEntry = 0;
+    frame.entryDepth = visitedEdges.size();
+    frame.maxDepth = frame.entryDepth;
+    frame.cutFrom = UINT32_MAX;
+    frame.depthCut = false;
+    frame.stackID = stackID;
+    addShortcutSteps(info);
+    frame.stepEnd = traversal.steps.size();
+    traversal.frames.push_back(frame);
+}
+
+// 在一个单独的UniasAlgo里把shortcut展开一次：分析栈和visitedEdges拷贝自当前状态，使用每个worker线程单独的一份workspace。
+// 展开的子树里taken为true，不会再查询ShortcutCache，所以不会嵌套。进入的节点超过ShortcutCache::getMaxSteps时返回false。
+bool UniasAlgo::expandShortcut(const GepInfo* info, TraversalSummary &summary) const{
+    static thread_local AliasWorkspace shortcutWorkspace;
+    auto start = std::chrono::steady_clock::now();
+    UniasAlgo sub;
+    sub.pag = pag;
+    sub.DL = DL;
+    sub.taskNode = taskNode;
+    sub.workspace = &shortcutWorkspace;
+    sub.dedupStates = dedupStates;
+    sub.AnalysisStack = AnalysisStack;
+    sub.visitedEdges = visitedEdges;
+    sub.startShortcut(info);
+    const bool finished = sub.resumeAlias(shortcuts->getMaxSteps());
+    shortcutWorkspace.swapBuffers(sub.traversal);
+    shortcuts->addExpandUs(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    if(!finished){
+        return false;
+    }
+    sub.Aliases.finalize();
+    // 不记录子树实际走到的深度，span按剩余的全部深度算：没有被MAX_PATH_EDGES截断时，在不深于当前的位置都能复用。
+    const u32_t depth = visitedEdges.size();
+    summary.depth = depth;
+    summary.span = depth < MAX_PATH_EDGES ? MAX_PATH_EDGES - depth : 0;
+    summary.depthCut = sub.metrics.rejectEdgeCap > 0;
+    const s64_t base = AnalysisStack.items().front().offset;
+    summary.aliases.reserve(sub.Aliases.totalNodes());
+    for(const auto &entry : sub.Aliases){
+        for(NodeID id : entry.nodes){
+            summary.aliases.emplace_back(entry.offset - base, pagSnapshot.getNode(id));
+        }
+    }
+    return true;
 }
 
-// ComputeAlias函数：Unias的核心算法，递归的写法相当于是深度优先遍历。
+// 走typebased shortcut前查询ShortcutCache，没有可用的结果时当场展开一次并存入。成功时把结果按当前栈底offset写回Aliases，
+// 不再生成shortcut的step。注意这是近似：结果是在第一次展开时的路径下算出来的，也不含当前路径上的icall和动态黑名单。
+bool UniasAlgo::spliceShortcut(const GepInfo* info, AliasFrame &frame){
+    ShortcutKey key;
+    key.stID = info->stID;
+    key.offset = info->offset;
+    const auto &items = AnalysisStack.items();
+    key.stack.reserve(items.size() - 1);
+    for(auto it = std::next(items.begin()); it != items.end(); ++it){
+        key.stack.push_back(packStackItem(*it));
+    }
+    const u32_t depth = visitedEdges.size();
+    bool tooLarge = false;
+    auto cached = shortcuts->lookup(key, depth, tooLarge);
+    if(tooLarge){
+        return false;
+    }
+    TraversalSummary expanded;
+    const TraversalSummary* summary = cached.get();
+    if(!summary){
+        if(!expandShortcut(info, expanded)){
+            shortcuts->markTooLarge(std::move(key));
+            return false;
+        }
+        summary = &expanded;
+    }
+    // 拼接进来的子树也算作当前帧子树的一部分。
+    frame.maxDepth = std::max(frame.maxDepth, depth + summary->span);
+    frame.depthCut |= summary->depthCut;
+    const s64_t base = items.front().offset;
+    for(const auto &alias : summary->aliases){
+        recordAlias(base + alias.first, alias.second);
+    }
+    shortcuts->addSpliced(summary->aliases.size());
+    if(!cached){
+        shortcuts->insert(std::move(key), std::move(expanded));
+    }
+    return true;
+}
+
+// 对应递归版ComputeAlias的函数体：统计、记录Alias，然后按原来的边处理顺序把所有候选的Prop展开成step，压入一帧。
+// 生成step时读到的分析栈/taken状态与递归版执行到该条边时一致，因为每个子调用返回前都会把它们复原。
 // state: true表示计算I-Alias关系和一些反向边，false表示计算flows-to关系的正向边。
-void UniasAlgo::ComputeAlias(PAGNode* cur, bool state){
+void UniasAlgo::enterNode(PAGNode* cur, bool state){
     // ComputeAlias调用次数统计与限制。
-    nodeFreq[cur]++;
+    workspace->countVisit(cur->getId());
+    if(trackEntered){
+        workspace->markEntered(cur->getId());
+    }
     counter++;
+    metrics.calls++;
+    metrics.maxStackDepth = std::max<u32_t>(metrics.maxStackDepth, AnalysisStack.size());
     if(counter > STAT_THRESHOLD){
-        vector<pair<PAGNode*, u64_t>> nodeFreqSorted;
-        sortMap(nodeFreqSorted, nodeFreq, 50);
-        for(auto i = 0; i < 50 && i < nodeFreqSorted.size(); i++){
-            blackNodes.insert(nodeFreqSorted[i].first->getId());
+        metrics.dynBlackTriggers++;
+        // 访问次数最多的50个节点加入动态黑名单，次数相同时取先访问到的。
+        vector<NodeID> hottest;
+        workspace->topFrequent(50, hottest);
+        for(auto id : hottest){
+            workspace->addDynBlack(id);
         }
 
-        nodeFreq.clear();
+        workspace->resetFreq();
         counter = 0;
+        if(summaries){
+            if(!traversal.frames.empty()){
+                markContextCut(nullptr, nullptr); // 之后的遍历受动态黑名单影响。
+            }
+        }
     }
-    
+
+    AliasFrame frame;
+    frame.stepBegin = traversal.steps.size();
+    frame.cursor = frame.stepBegin;
+    frame.inChild = false;
+    frame.node = cur;
+    frame.state = state;
+    frame.logBegin = summaries ? traversal.aliasLog.size() : AliasFrame::NO_LOG;
+    frame.stepsAtEntry = traversal.stepsDone;
+    frame.entryDepth = visitedEdges.size();
+    frame.maxDepth = frame.entryDepth;
+    frame.cutFrom = UINT32_MAX;
+    frame.depthCut = false;
+    frame.stackID = stackID;
+
     // 1. 处理初始栈节点。
     // 2. 在分析过程中，分析栈里规约到只剩一个节点时，也需要记录一下Alias结果。
     // （此时没有offset要求，也即各个field都可能被记录aliases）
     if(AnalysisStack.size() == 1){
-        Aliases[AnalysisStack.top().offset].insert(cur); // 只有这里会设置Aliases的结果。
+        recordAlias(AnalysisStack.top().offset, cur); // 只有这里会设置Aliases的结果。
     }
+    // 所有邻边都从只读的pagSnapshot里按组取，组的顺序就是下面各类边的处理顺序。
+    // 快照中只保留了可进入的Call/Ret边（见setupCallAdmissibility），这里不再检查callee。
+    const NodeID curID = cur->getId();
+    const u32_t mask = pagSnapshot.getMask(curID);
+    if(mask == 0){
+        frame.stepEnd = traversal.steps.size();
+        traversal.frames.push_back(frame);
+        return;
+    }
+    auto has = [mask](SnapGroup g){ return (mask >> g) & 1; };
+
     // 处理正向Load边（规则1、4，后者边）。
-    if(cur->hasOutgoingEdges(PAGEdge::Load)){
-        for(auto edge : cur->getOutgoingEdges(PAGEdge::Load)){
-            if(AnalysisStack.size() > 1){
-                auto &topItem = AnalysisStack.top();
-                // if(topItem.curFlow == false && (topItem.isVariant || topItem.offset == 0)){
-                if(topItem.offset == 0){
-                    AnalysisStack.pop(); // 这里pop()应该是指正向的store边和load边完成了规则1的配对。继续Prop分析下一个节点。
-                    Prop(edge->getDstNode(), edge, false, nullptr);
-                    AnalysisStack.push(topItem);
-                }
+    if(has(SG_LoadOut) && AnalysisStack.size() > 1){
+        const auto topItem = AnalysisStack.top();
+        // if(topItem.curFlow == false && (topItem.isVariant || topItem.offset == 0)){
+        if(topItem.offset == 0){
+            for(auto &se : pagSnapshot.get(curID, SG_LoadOut)){
+                // 这里pop()应该是指正向的store边和load边完成了规则1的配对。继续Prop分析下一个节点。
+                addStep(se.nbr, se.edge, false, nullptr, OpPop, topItem);
             }
         }
     }
-    
+
     // 处理反向Store边（规则2， 后者边）。
-    if(AnalysisStack.size() > 1){
-        auto &topItem = AnalysisStack.top();
-        if(topItem.curFlow && topItem.offset == 0 && cur->hasIncomingEdges(PAGEdge::Store)){
-            for(auto edge : cur->getIncomingEdges(PAGEdge::Store)){
-                AnalysisStack.pop(); // 这里pop()应该是指反向的load边和store边完成了规则2的配对。继续Prop分析下一个节点。
-                Prop(edge->getSrcNode(), edge, true, nullptr);
-                AnalysisStack.push(topItem);
+    if(has(SG_StoreIn) && AnalysisStack.size() > 1){
+        const auto topItem = AnalysisStack.top();
+        if(topItem.curFlow && topItem.offset == 0){
+            for(auto &se : pagSnapshot.get(curID, SG_StoreIn)){
+                // 这里pop()应该是指反向的load边和store边完成了规则2的配对。继续Prop分析下一个节点。
+                addStep(se.nbr, se.edge, true, nullptr, OpPop, topItem);
             }
         }
     }
 
     // 处理正向Assign边（各种Assign边的子类）。
     // 遇到这类边都是直接Prop（state均为false），不使用AnalysisStack。
-    // if(AnalysisStack.size() > 1){
-        if(cur->hasOutgoingEdges(PAGEdge::Copy)){
-            for(auto edge : cur->getOutgoingEdges(PAGEdge::Copy)){
-                Prop(edge->getDstNode(), edge, false, nullptr);
-            }
-        }
-        
-        if(selectOut.find(cur->getId()) != selectOut.end()){
-            for(auto edge : selectOut[cur->getId()]){
-                for(auto dst : edge.second){
-                    Prop(pag->getGNode(dst), edge.first, false, nullptr);
-                }
+    for(auto g : {SG_CopyOut, SG_SelectOut, SG_PhiOut}){
+        if(has(g)){
+            for(auto &se : pagSnapshot.get(curID, g)){
+                addStep(se.nbr, se.edge, false, nullptr);
             }
         }
-        if(phiOut.find(cur->getId()) != phiOut.end()){
-            for(auto edge : phiOut[cur->getId()]){
-                for(auto dst : edge.second){
-                    Prop(pag->getGNode(dst), edge.first, false, nullptr);
-                }
-            }
+    }
+    if(has(SG_Real2Formal)){
+        for(auto &se : pagSnapshot.get(curID, SG_Real2Formal)){
+            addStep(se.nbr, nullptr, false, cur);
         }
-        if(Real2Formal.find(cur->getId()) != Real2Formal.end()){
-            for(auto formal : Real2Formal[cur->getId()]){
-                Prop(pag->getGNode(formal), nullptr, false, cur);
-            }
+    }
+    if(has(SG_CallOut)){
+        for(auto &se : pagSnapshot.get(curID, SG_CallOut)){
+            addStep(se.nbr, se.edge, false, nullptr);
         }
-        if(cur->hasOutgoingEdges(PAGEdge::Call)){
-            for(auto edge : cur->getOutgoingEdges(PAGEdge::Call)){
-                const auto callee = SVFUtil::getCallee(dyn_cast<CallPE>(edge)->getCallInst()->getCallSite())->getName();
-                if(blackCalls.find(callee) == blackCalls.end()
-                    && callee.find("kmalloc") == string::npos
-                    && callee.find("kzalloc") == string::npos
-                    && callee.find("kcalloc") == string::npos
-                ){
-                    // 要求callee不在黑名单中，且不是kmalloc、kzalloc、kcalloc，才能执行Prop操作。
-                    Prop(edge->getDstNode(), edge, false, nullptr);
-                }
-            }
-        }   
-        
-        if(Ret2Call.find(cur->getId()) != Ret2Call.end()){
-            for(auto callsite : Ret2Call[cur->getId()]){
-                Prop(pag->getGNode(callsite), nullptr, false, pag->getGNode(callsite));
-            }
+    }
+    if(has(SG_Ret2Call)){
+        for(auto &se : pagSnapshot.get(curID, SG_Ret2Call)){
+            addStep(se.nbr, nullptr, false, se.nbr);
         }
-        if(cur->hasOutgoingEdges(PAGEdge::Ret)){
-            for(auto edge : cur->getOutgoingEdges(PAGEdge::Ret)){
-                const auto callee = SVFUtil::getCallee(dyn_cast<RetPE>(edge)->getCallInst()->getCallSite())->getName();
-                if(blackRets.find(callee) == blackRets.end()
-                    && callee.find("kmalloc") == string::npos
-                    && callee.find("kzalloc") == string::npos
-                    && callee.find("kcalloc") == string::npos
-                ){
-                    Prop(edge->getDstNode(), edge, false, nullptr);
-                }
-            }
+    }
+    if(has(SG_RetOut)){
+        for(auto &se : pagSnapshot.get(curID, SG_RetOut)){
+            addStep(se.nbr, se.edge, false, nullptr);
         }
-    // }
-    
+    }
+
     // 处理反向Assign边。
     // 遇到这类边都是直接Prop（state均为true），不使用AnalysisStack。
     if(state){
-        if(cur->hasIncomingEdges(PAGEdge::Copy)){
-            for(auto edge : cur->getIncomingEdges(PAGEdge::Copy)){
-                Prop(edge->getSrcNode(), edge, true, nullptr);
-            }
-        }
-        if(selectIn.find(cur->getId()) != selectIn.end()){
-            for(auto edge : selectIn[cur->getId()]){
-                for(auto src : edge.second){
-                    Prop(pag->getGNode(src), edge.first, true, nullptr);
-                }
-            }
-        }
-        if(phiIn.find(cur->getId()) != phiIn.end()){
-            for(auto edge : phiIn[cur->getId()]){
-                for(auto src : edge.second){
-                    Prop(pag->getGNode(src), edge.first, true, nullptr);
+        for(auto g : {SG_CopyIn, SG_SelectIn, SG_PhiIn}){
+            if(has(g)){
+                for(auto &se : pagSnapshot.get(curID, g)){
+                    addStep(se.nbr, se.edge, true, nullptr);
                 }
             }
         }
-        if(Formal2Real.find(cur->getId()) != Formal2Real.end()){
-            for(auto real : Formal2Real[cur->getId()]){
-                Prop(pag->getGNode(real), nullptr, true, pag->getGNode(real));
+        if(has(SG_Formal2Real)){
+            for(auto &se : pagSnapshot.get(curID, SG_Formal2Real)){
+                addStep(se.nbr, nullptr, true, se.nbr);
             }
         }
-        if(cur->hasIncomingEdges(PAGEdge::Call)){
-            for(auto edge : cur->getIncomingEdges(PAGEdge::Call)){
-                const auto callee = SVFUtil::getCallee(dyn_cast<CallPE>(edge)->getCallInst()->getCallSite())->getName();
-                if(blackCalls.find(callee) == blackCalls.end()
-                    && callee.find("kmalloc") == string::npos
-                    && callee.find("kzalloc") == string::npos
-                    && callee.find("kcalloc") == string::npos
-                ){
-                    Prop(edge->getSrcNode(), edge, true, nullptr);
-                }
+        if(has(SG_CallIn)){
+            for(auto &se : pagSnapshot.get(curID, SG_CallIn)){
+                addStep(se.nbr, se.edge, true, nullptr);
             }
         }
-        if(Call2Ret.find(cur->getId()) != Call2Ret.end()){
-            for(auto ret : Call2Ret[cur->getId()]){
-                Prop(pag->getGNode(ret), nullptr, true, cur);
+        if(has(SG_Call2Ret)){
+            for(auto &se : pagSnapshot.get(curID, SG_Call2Ret)){
+                addStep(se.nbr, nullptr, true, cur);
             }
         }
-        if(cur->hasIncomingEdges(PAGEdge::Ret)){
-            for(auto edge : cur->getIncomingEdges(PAGEdge::Ret)){
-                const auto callee = SVFUtil::getCallee(dyn_cast<RetPE>(edge)->getCallInst()->getCallSite())->getName();
-                if(blackRets.find(callee) == blackRets.end()
-                    && callee.find("kmalloc") == string::npos
-                    && callee.find("kzalloc") == string::npos
-                    && callee.find("kcalloc") == string::npos
-                ){
-                    Prop(edge->getSrcNode(), edge, true, nullptr);
-                }
+        if(has(SG_RetIn)){
+            for(auto &se : pagSnapshot.get(curID, SG_RetIn)){
+                addStep(se.nbr, se.edge, true, nullptr);
             }
         }
     }
 
     // 处理正向Store边（规则1，前者边）。
-    // if(AnalysisStack.size() > 1 && cur->hasOutgoingEdges(PAGEdge::Store)){
-    if(cur->hasOutgoingEdges(PAGEdge::Store)){
-        for(auto edge : cur->getOutgoingEdges(PAGEdge::Store)){
-            auto dstNode = edge->getDstNode();
-            PNwithOffset newTypeInfo(0, false);
-            AnalysisStack.push(newTypeInfo);
-            Prop(dstNode, edge, true, nullptr); // 将state设置为true，用来匹配反向边。
-            AnalysisStack.pop(); // Prop之后都是要将栈复原的，相当于目前这条edge的分析已经结束了。
-        }
-    }
-    
-
-    // 处理反向Load边（规则2、4，前者边）。
-    if(state && cur->hasIncomingEdges(PAGEdge::Load)){
-        for(auto edge : cur->getIncomingEdges(PAGEdge::Load)){
-            auto srcNode = edge->getSrcNode();
-            PNwithOffset newTypeInfo(0, true); // 这里将curFlow设为true
-            AnalysisStack.push(newTypeInfo);
-            Prop(srcNode, edge, true, nullptr);
-            AnalysisStack.pop();
+    // 将state设置为true，用来匹配反向边。返回后都是要将栈复原的，相当于目前这条edge的分析已经结束了。
+    if(has(SG_StoreOut)){
+        for(auto &se : pagSnapshot.get(curID, SG_StoreOut)){
+            addStep(se.nbr, se.edge, true, nullptr, OpPush, PNwithOffset(0, false));
+        }
+    }
+
+    // 处理反向Load边（规则2、4，前者边）。这里将curFlow设为true。
+    if(state && has(SG_LoadIn)){
+        for(auto &se : pagSnapshot.get(curID, SG_LoadIn)){
+            addStep(se.nbr, se.edge, true, nullptr, OpPush, PNwithOffset(0, true));
         }
     }
 
-    // void collectByteoffset(SVFIR* pag)：负责variantGep、gep2byteoffset的初始化。
+    // void collectByteoffset(SVFIR* pag)、finalizeGepInfos(SVFIR* pag)：负责gepInfos的初始化。
 
     // 处理反向Gep边及Shortcuts。
-    if(state && cur->hasIncomingEdges(PAGEdge::Gep)){
-        for(auto edge : cur->getIncomingEdges(PAGEdge::Gep)){
+    if(state && has(SG_GepIn)){
+        for(auto &se : pagSnapshot.get(curID, SG_GepIn)){
+            PAGEdge* edge = se.edge;
             assert(!AnalysisStack.empty());
-            // if(!AnalysisStack.empty()){
-            auto &topItem = AnalysisStack.top();
-            if(variantGep.find(edge) != variantGep.end()){ // 如果是variantGep，回退到field不敏感的分析。
-                Prop(edge->getSrcNode(), edge, true, nullptr);
-            }else if(gep2byteoffset.find(edge) != gep2byteoffset.end()){ // constantGEP且能根据GEP边获取字节数偏移。
+            const GepInfo* info = getGepInfo(edge); // 一次取出offset、variant标记和shortcut资格（这是初始化时计算的）。
+            if(!info){
+                continue;
+            }
+            if(info->flags & GEP_VARIANT){ // 如果是variantGep，回退到field不敏感的分析。
+                addStep(se.nbr, edge, true, nullptr);
+            }else if(info->flags & GEP_HAS_OFFSET){ // constantGEP且能根据GEP边获取字节数偏移。
                 // Consider taking shortcut?
                 bool castShortcutTaken = false;
-                const auto offset = gep2byteoffset[edge]; // 获取当前GEP边的offset字节数（这是初始化时计算的）。
-                if(!taken && ifValidForTypebasedShortcut(edge, SC_THRESHOLD * 5)){ // 如果判断为可以做shortcuts，进入if body。
-                    taken = true;
-                    unordered_set<PAGNode*> visitedShortcuts;
-                    auto sttype = ifPointToStruct(edge->getSrcNode()->getType()); // TODO: 理论上应该检查下nullptr。
-                    const auto stname = getStructName(sttype);
-                    // 处理Field-to-Field Shortcuts，并进行Prop。
-                    if(typebasedShortcuts.find(stname) != typebasedShortcuts.end()
-                        && typebasedShortcuts[stname].find(offset) != typebasedShortcuts[stname].end()
-                    ){
-                        for(auto dstShort : typebasedShortcuts[stname][offset]){
-                            Prop(dstShort->getDstNode(), dstShort, false, nullptr);
-                            visitedShortcuts.insert(dstShort->getDstNode());
-                        }
+                const auto offset = info->offset; // 获取当前GEP边的offset字节数。
+                if(!taken && (info->flags & GEP_TYPEBASED_SC)){ // 如果判断为可以做shortcuts，进入if body。
+                    if(shortcuts && spliceShortcut(info, frame)){ // 这个(结构体, offset, 栈形状)已经展开过，直接拼接结果。
+                        castShortcutTaken = (info->flags & GEP_CASTSITE_SC) != 0;
+                    }else{
+                        addStep(nullptr, nullptr, false, nullptr, OpSetTaken); // shortcuts后面的节点都不能再走shortcut。
+                        castShortcutTaken = addShortcutSteps(info);
+                        addStep(nullptr, nullptr, false, nullptr, OpClearTaken); // shortcuts后面的节点递归分析结束，恢复taken状态。
                     }
-                    // 处理Additional Shortcuts，并进行Prop。（Unias论文里似乎没提到这个）
-                    if(additionalShortcuts.find(stname) != additionalShortcuts.end()
-                        && additionalShortcuts[stname].find(offset) != additionalShortcuts[stname].end()
-                    ){
-                        for(auto dstSet : additionalShortcuts[stname][offset]){
-                            for(auto dstShort : *dstSet){
-                                if(visitedShortcuts.insert(dstShort->getDstNode()).second){
-                                    Prop(dstShort->getDstNode(), dstShort, false, nullptr);
-                                }
-                            }
-                        }
-                    }
-                    // 处理Field-to-CastSite Shortcuts。
-                    if(ifValidForCastSiteShortcut(edge, SC_THRESHOLD)){
-                        if(castSites.find(stname) != castSites.end()){
-                            // 遍历所有符合类型的CastSites。每个dstCast都是一个Cast类型的PAGEdge*。
-                            for(auto dstCast : castSites[stname]){
-                                bool needVisitDst = false;
-                                bool needVisitSrc = false;
-                                // 检查Cast边的Src节点的类型信息。
-                                if(auto castSrcTy = dstCast->getSrcNode()->getType()){
-                                    if(auto castSrcSt = ifPointToStruct(castSrcTy)){
-                                        if(getStructName(castSrcSt) == stname){
-                                            needVisitDst = true;
-                                        }else{
-                                            needVisitSrc = true;
-                                        }
-                                    }else{
-                                        needVisitSrc = true;
-                                    }
-                                }else{
-                                    needVisitSrc = true;
-                                }
-                                // 检查Cast边的Dst节点的类型信息。
-                                if(auto castDstTy  = dstCast->getDstNode()->getType()){
-                                    if(auto castDstSt = ifPointToStruct(castDstTy)){
-                                        if(getStructName(castDstSt) == getStructName(sttype)){
-                                            needVisitSrc = true;
-                                        }else{
-                                            needVisitDst = true;
-                                        }
-                                    }else{
-                                        needVisitDst = true;
-                                    }
-                                }else{
-                                    needVisitDst = true;
-                                }
-                                // 判断应该在Cast边的Src端还是Dest端进行Prop。
-                                // 注意：前面两处走shortcut时都没有对topItem.offset进行修改，这里略有不同。
-                                // 解释：需要先减去offset，是因为走Cast的shortcut过去后还要再匹配一条正向GEP边。
-                                if(needVisitSrc){
-                                    topItem.offset -= offset;
-                                    Prop(dstCast->getSrcNode(), dstCast, true, nullptr);
-                                    topItem.offset += offset;
-                                }
-                                if(needVisitDst){
-                                    topItem.offset -= offset;
-                                    Prop(dstCast->getDstNode(), dstCast, false, nullptr);
-                                    topItem.offset += offset;
-                                }
-                            }
-                        }
-                        castShortcutTaken = true; // 表示CastSite类型的shortcut是可以处理的。
-                    }
-                    taken = false; // shortcuts后面的节点递归分析结束，恢复该变量状态。
                 }
                 // 这里相当于是不走shortcut，进行基础数据流分析，直接在当前GEP反向边的Src节点进行Prop。
                 // TODO：这样设计其实是不sound的，会忽略PAG本地附近区域的alias及读写情况。
                 if(!castShortcutTaken){ // 如果在处理当前GEP反向边时，没有做CastSite类型的shortcut，才能进入if。（按论文mutually exclusive的设计）
-                    topItem.offset -= offset;
-                    Prop(edge->getSrcNode(), edge, true, nullptr);
-                    topItem.offset += offset;
+                    addStep(se.nbr, edge, true, nullptr, OpOffset, PNwithOffset(), -offset);
                 }
             }
-                
-            // }
         }
     }
 
     // 处理正向Gep边。
-    if(cur->hasOutgoingEdges(PAGEdge::Gep)){
-        for(auto edge : cur->getOutgoingEdges(PAGEdge::Gep)){
-            auto &topItem = AnalysisStack.top();
-            if(variantGep.find(edge) != variantGep.end()){ // 如果是variantGep，回退到field不敏感的分析。
-                // topItem.isVariant = true;
-                Prop(edge->getDstNode(), edge, true, nullptr);
-                // topItem.isVariant = false;
-            }else if(gep2byteoffset.find(edge) != gep2byteoffset.end()){ // 根据GEP边获取字节数offset（而不是index偏移）。
-                topItem.offset += gep2byteoffset[edge];
-                // topItem.geptimes++;
-                // if(topItem.geptimes < 4)
-                    Prop(edge->getDstNode(), edge, true, nullptr);
-                // topItem.geptimes--;
-                topItem.offset -= gep2byteoffset[edge]; // 栈顶元素offset恢复原状。
+    if(has(SG_GepOut)){
+        for(auto &se : pagSnapshot.get(curID, SG_GepOut)){
+            PAGEdge* edge = se.edge;
+            const GepInfo* info = getGepInfo(edge);
+            if(!info){
+                continue;
+            }
+            if(info->flags & GEP_VARIANT){ // 如果是variantGep，回退到field不敏感的分析。
+                addStep(se.nbr, edge, true, nullptr);
+            }else if(info->flags & GEP_HAS_OFFSET){ // 根据GEP边获取字节数offset（而不是index偏移）。
+                addStep(se.nbr, edge, true, nullptr, OpOffset, PNwithOffset(), info->offset);
             }
         }
     }
-    
+
+    frame.stepEnd = traversal.steps.size();
+    traversal.frames.push_back(frame);
+}
+
+// 开始一次新的遍历：清空显式栈，把起点作为第一帧压入。
+void UniasAlgo::startAlias(PAGNode* cur, bool state){
+    if(!workspace){
+        ownWorkspace.reset(new AliasWorkspace());
+        workspace = ownWorkspace.get();
+    }
+    workspace->begin(pagSnapshot.numNodes());
+    workspace->swapBuffers(traversal); // 借用上一个GV留下的缓冲区。
+    AnalysisStack.reserve(MAX_PATH_EDGES + 2);
+    stackID = EMPTY_STACK_ID;
+    if(dedupStates){
+        for(auto &item : AnalysisStack.items()){
+            stackID = workspace->stacks.push(stackID, packStackItem(item));
+        }
+    }
+    traversal.frames.clear();
+    traversal.steps.clear();
+    traversal.stepsDone = 0;
+    traversal.aliasLog.clear();
+    traversal.pathEdges.assign(summaries ? 1 : 0, nullptr);
+    traversal.pathIcalls.assign(summaries ? 1 : 0, nullptr);
+    enterNode(cur, state);
+}
+
+// 继续执行当前遍历，最多进入maxSteps个子节点。遍历结束返回true，否则返回false，之后可以再次resume。
+// 暂停时的完整状态就是traversal加上AnalysisStack、visitedEdges、workspace和taken，
+// 可以整体搬到别的线程上继续，只要期间没有别的UniasAlgo使用同一个workspace。
+bool UniasAlgo::resumeAlias(u64_t maxSteps){
+    u64_t entered = 0;
+    while(!traversal.frames.empty()){
+        AliasFrame &frame = traversal.frames.back();
+        if(frame.inChild){
+            // 子节点分析结束，相当于递归版中Prop里的ComputeAlias返回。
+            propLeave(traversal.steps[frame.cursor]);
+            frame.inChild = false;
+            frame.cursor++;
+            continue;
+        }
+        if(frame.cursor == frame.stepEnd){
+            if(summaries){
+                saveSummary(frame);
+                if(traversal.frames.size() > 1){
+                    auto &parent = traversal.frames[traversal.frames.size() - 2];
+                    parent.maxDepth = std::max(parent.maxDepth, frame.maxDepth);
+                    parent.depthCut |= frame.depthCut;
+                    parent.cutFrom = std::min(parent.cutFrom, frame.cutFrom);
+                }
+                traversal.pathEdges.pop_back();
+                traversal.pathIcalls.pop_back();
+            }
+            traversal.steps.resize(frame.stepBegin);
+            traversal.frames.pop_back();
+            continue;
+        }
+        const PropStep &step = traversal.steps[frame.cursor];
+        if(step.op == OpSetTaken || step.op == OpClearTaken){
+            taken = (step.op == OpSetTaken);
+            frame.cursor++;
+            continue;
+        }
+        if(entered >= maxSteps){
+            return false;
+        }
+        if(!propEnter(step)){
+            frame.cursor++;
+            continue;
+        }
+        // 同一GV里已经在不浅于当前的深度展开过这个状态，子树不会再有新的结果（近似，见VisitedStates）。
+        if(dedupStates && !workspace->states.visit(step.nxt->getId(), stackID, step.state, taken, visitedEdges.size())){
+            metrics.rejectState++;
+            if(summaries){
+                markContextCut(nullptr, nullptr); // 被跳过的子树结果记在别的帧里，当前路径上的帧都不能做摘要。
+            }
+            propLeave(step);
+            frame.cursor++;
+            continue;
+        }
+        entered++;
+        traversal.stepsDone++;
+        if(summaries && spliceSummary(step.nxt, step.state)){
+            propLeave(step);
+            frame.cursor++;
+            continue;
+        }
+        frame.inChild = true;
+        if(summaries){
+            traversal.pathEdges.push_back(step.eg);
+            traversal.pathIcalls.push_back(step.icall);
+        }
+        // enterNode会向frames/steps追加元素，frame和step引用在此之后失效。
+        PAGNode* nxt = step.nxt;
+        bool nxtState = step.state;
+        enterNode(nxt, nxtState);
+    }
+    return true;
+}
+
+// ComputeAlias函数：Unias的核心算法，相当于对PAG做深度优先遍历。
+// 这里用显式栈代替递归，避免内核里很深的调用链把线程栈撑爆。
+void UniasAlgo::ComputeAlias(PAGNode* cur, bool state){
+    ComputeAliasWithin(cur, state, AliasBudget());
+}
+
+const char* truncReasonName(TruncReason reason){
+    switch(reason){
+        case TruncNone:  return "none";
+        case TruncTime:  return "time";
+        case TruncSteps: return "steps";
+    }
+    return "unknown";
+}
+
+// 分片执行不会改变遍历顺序：resumeAlias暂停时的状态完整保存在traversal等成员中，继续执行与一次跑完相同。
+bool UniasAlgo::ComputeAliasWithin(PAGNode* cur, bool state, const AliasBudget &budget){
+    auto start = std::chrono::steady_clock::now();
+    truncated = TruncNone;
+    startAlias(cur, state);
+    if(budget.unlimited()){
+        resumeAlias(UINT64_MAX);
+    }else{
+        while(true){
+            u64_t slice = BUDGET_CHECK_STEPS;
+            if(budget.steps){
+                slice = std::min<u64_t>(slice, budget.steps - traversal.stepsDone);
+            }
+            // resumeAlias只在还需要进入子节点时才返回false，所以恰好用完步数的遍历不会被误判为截断。
+            if(resumeAlias(slice)){
+                break;
+            }
+            if(budget.steps && traversal.stepsDone >= budget.steps){
+                truncated = TruncSteps;
+                break;
+            }
+            if(budget.timeUs && (u64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() >= budget.timeUs){
+                truncated = TruncTime;
+                break;
+            }
+        }
+    }
+    workspace->swapBuffers(traversal); // 遍历不会再继续，把缓冲区还给workspace。
+    Aliases.finalize();
+    analysisUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return truncated == TruncNone;
 }
 
 // [Added by LHY]
 // 该函数用于对Aliases结果进行处理，把byteOffset转化回结构体的OriginalElem的index，使输出结果更可读。
 void UniasAlgo::postProcessGV() {
 
-}
\ No newline at end of file
+}
@@ -1,14 +1,27 @@
 #include "../include/Util.hpp"
+#include "../include/InitGraph.hpp"
 #include "../include/UtilLLVM.hpp"
 #include "llvm/Support/raw_ostream.h"
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
 
 // llvm::cl::opt<std::string> SpecifyInput("SpecifyInput",
 //     llvm::cl::desc("specify input such as indirect calls or global variables"), llvm::cl::init(""));
 
+unordered_set<string> NewInitFuncstr; // 内核中的初始化函数，由getNewInitFuncs读入，用于checkIfProtectable()。
+
 unordered_set<string> blackCalls;
 unordered_set<string> blackRets;
 
-unordered_set<NodeID> blackNodes;
+BitVector blackNodes;
+NodeID nodeIDBound = 0;
+
+vector<string> allocDenyList = {"kmalloc", "kzalloc", "kcalloc"};
+BitVector blockedCallEdges;
 
 unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> phiIn;
 unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> phiOut;
@@ -19,21 +32,26 @@ unordered_map<NodeID, unordered_map<SVFStmt*, unordered_set<NodeID>>> selectOut;
 // unordered_map<const SVFType*, unordered_set<const SVFFunction*>> type2funcs;
 
 // Shortcuts相关。
-unordered_map<string, unordered_map<u32_t, unordered_set<PAGEdge*>>> typebasedShortcuts; // {structName -> {offset -> PAGEdgeSet}}
-unordered_map<string, unordered_map<u32_t, unordered_set<unordered_set<PAGEdge*>*>>> additionalShortcuts; // {structName -> {offset -> ...}}
-unordered_map<string, unordered_set<PAGEdge*>> castSites; // {structName -> PAGEdgeSet}
-unordered_map<PAGEdge*, unordered_map<u32_t, unordered_set<string>>> reverseShortcuts;
+unordered_map<StructID, unordered_map<u32_t, unordered_set<PAGEdge*>>> typebasedShortcuts; // {structID -> {offset -> PAGEdgeSet}}
+unordered_map<StructID, unordered_map<u32_t, unordered_set<unordered_set<PAGEdge*>*>>> additionalShortcuts; // {structID -> {offset -> ...}}
+unordered_map<StructID, unordered_set<PAGEdge*>> castSites; // {structID -> PAGEdgeSet}
+unordered_map<PAGEdge*, unordered_map<u32_t, unordered_set<StructID>>> reverseShortcuts;
 unordered_map<PAGNode*, PAGEdge*> gepIn; // 把GEP边的DestNode映射到GEP边。
 
 // Field-sensitivity相关。
-unordered_map<const PAGEdge*, long> gep2byteoffset; // {FieldEdge -> byteOffset} // 记录Field边对应的byteOffset值。
-unordered_set<const PAGEdge*> variantGep; // [FieldEdges] // 记录所有offset为non-constant的Field边。
+vector<GepInfo> gepInfos; // {EdgeID -> GepInfo} // 记录Field边的byteOffset值、是否non-constant及shortcut资格。
 
 // 记录Value与其对应的Module，便于我们恢复Datalayout信息。(Added by LHY)
 unordered_map<const Value*, const Module*> value2Module; // Don't refactor this to SVFValue. 
 
 unordered_map<StructType*, string> deAnonymousStructs;   // Refactor this to SVFStructType???
 
+// 结构体ID相关。
+vector<string> structNames;
+static unordered_map<string, StructID> structName2ID;
+unordered_map<const StructType*, StructID> structType2ID;
+vector<StructID> node2StructID;
+
 // CallGraph相关。
 unordered_map<const CallInst*, unordered_set<const Function*>> callgraph; // Refactor this to SVFCallInst and SVFFunction???
 unordered_map<NodeID, unordered_set<NodeID>> Real2Formal;
@@ -42,6 +60,67 @@ unordered_map<NodeID, unordered_set<NodeID>> Ret2Call;
 unordered_map<NodeID, unordered_set<NodeID>> Call2Ret;
 bool ifCallGraphSet = false;
 
+// [tool] 当前进程的常驻内存（KB），读取/proc/self/statm，失败时返回0。
+u64_t getCurrentRSSKB(){
+    ifstream fin("/proc/self/statm");
+    u64_t sizePages = 0, residentPages = 0;
+    if(!(fin >> sizePages >> residentPages)){
+        return 0;
+    }
+    return residentPages * (u64_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// [tool] 转义后可直接放进JSON字符串的引号之间。
+string jsonEscape(const string &str){
+    string ret;
+    for(char c : str){
+        if(c == '"' || c == '\\'){
+            ret += '\\';
+            ret += c;
+        }else if((unsigned char)c < 0x20){
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            ret += buf;
+        }else{
+            ret += c;
+        }
+    }
+    return ret;
+}
+
+// [tool] 临时文件名带上进程号和进程内的序号，多个worker同时写同一个目录也不会冲突。
+bool writeFileAtomically(const string &path, const string &buf){
+    static std::atomic<u64_t> tmpCounter(0);
+    const string tmpPath = path + ".tmp." + to_string(getpid()) + "." + to_string(tmpCounter++);
+    FILE* fp = fopen(tmpPath.c_str(), "wb");
+    if(!fp){
+        return false;
+    }
+    bool ok = fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+    ok = (fclose(fp) == 0) && ok;
+    if(!ok || rename(tmpPath.c_str(), path.c_str()) != 0){
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readWholeFile(const string &path, string &buf){
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(!fp){
+        return false;
+    }
+    buf.clear();
+    char chunk[1 << 16];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), fp)) > 0){
+        buf.append(chunk, n);
+    }
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
 void sortMap(std::vector<pair<PAGNode*, u64_t>> &sorted, unordered_map<PAGNode*, u64_t> &before, int k){
     sorted.reserve(before.size());
     for (const auto& kv : before) {
@@ -83,30 +162,42 @@ uint64_t getSizeInBytes(Type *type) {
     }
 }
 
+// [tool] NodeID不一定连续（部分symbol没有对应的PAG节点），dense表统一按最大NodeID+1分配。
+NodeID getNodeIDBound(SVFIR* pag){
+    NodeID bound = 0;
+    for(auto it = pag->begin(), ie = pag->end(); it != ie; ++it){
+        bound = std::max(bound, it->first + 1);
+    }
+    return bound;
+}
+
 // [initialize]
 void getBlackNodes(SVFIR* pag){
-    errs() << "[initialize] Exec getBlackNodes...\n";
+    initLog() << "[initialize] Exec getBlackNodes...\n";
+    nodeIDBound = getNodeIDBound(pag);
+    blackNodes.clear();
+    blackNodes.resize(nodeIDBound);
     // dataflow cannot through constants
     for(auto edge : pag->getGNode(pag->getConstantNode())->getOutgoingEdges(PAGEdge::Addr)){
-        blackNodes.insert(edge->getDstID());
+        blackNodes.set(edge->getDstID());
     }
-    errs() << "blackConsts: " << blackNodes.size() << "\n";
+    initLog() << "blackConsts: " << blackNodes.count() << "\n";
 
     // dummy nodes in pag
     for(u32_t i = 0; i < 4; i++){
-        blackNodes.insert(i);
+        blackNodes.set(i);
     }
 
     // llvm.compiler.used
     const auto llvm_compiler_used = pag->getGNode(4);
     if(llvm_compiler_used->hasValue() && llvm_compiler_used->getValueName() == "llvm.compiler.used"){
-        blackNodes.insert(4);
+        blackNodes.set(4);
     }
 
     // Func-calls
     unordered_map<const Function*, unsigned int> callees;
     unordered_map<const Function*, unordered_set<NodeID>> calleeNodes;
-    unordered_set<NodeID> blackCalls;
+    unordered_set<NodeID> blackCallNodes;
     for(auto calledge : pag->getSVFStmtSet(PAGEdge::Call)){
         // TODO: No elegant here...
         auto callPE = dyn_cast<CallPE>(calledge);
@@ -120,22 +211,22 @@ void getBlackNodes(SVFIR* pag){
         if(callee.second / (callee.first->arg_size() + 1) > BASE_NUM * 5){
             if(callee.first->getName().find('.') == string::npos){
                 for(auto node : calleeNodes[callee.first]){
-                    blackNodes.insert(node);
-                    blackCalls.insert(node);
+                    blackNodes.set(node);
+                    blackCallNodes.insert(node);
                 }
             }else if(callee.second / (callee.first->arg_size() + 1) > BASE_NUM * 10){
                 for(auto node : calleeNodes[callee.first]){
-                    blackNodes.insert(node);
-                    blackCalls.insert(node);
+                    blackNodes.set(node);
+                    blackCallNodes.insert(node);
                 }
             }
         }
     }
-    errs() << "blackCalls: " << blackCalls.size() << "\n";
+    initLog() << "blackCalls: " << blackCallNodes.size() << "\n";
 
     unordered_map<string, unsigned int> rets;
     unordered_map<string, unordered_set<NodeID>> retNodes;
-    unordered_set<NodeID> blackRets;
+    unordered_set<NodeID> blackRetNodes;
     for(auto retEdge : pag->getSVFStmtSet(PAGEdge::Ret)){
         auto retinst = dyn_cast<RetPE>(retEdge);
         auto func = SVFUtil::getCallee(retinst->getCallInst()->getCallSite())->getName();
@@ -146,57 +237,128 @@ void getBlackNodes(SVFIR* pag){
         if(ret.second > BASE_NUM * 5){
             if(ret.first.find('.') == string::npos){
                 for(auto node : retNodes[ret.first]){
-                    blackNodes.insert(node);
-                    blackRets.insert(node);
+                    blackNodes.set(node);
+                    blackRetNodes.insert(node);
                 }
             }else if(ret.second > BASE_NUM * 10){
                 for(auto node : retNodes[ret.first]){
-                    blackNodes.insert(node);
-                    blackRets.insert(node);
+                    blackNodes.set(node);
+                    blackRetNodes.insert(node);
                 }
             }
         }
     }
-    errs() << "blackRets: " << blackRets.size() << "\n";
+    initLog() << "blackRets: " << blackRetNodes.size() << "\n";
     
     for(auto i = 0; i < pag->getNodeNumAfterPAGBuild(); i++){
         auto node = pag->getGNode(i);
         if(node->getIncomingEdges(PAGEdge::Store).size() > O_BASE * 50){
-            blackNodes.insert(i);
+            blackNodes.set(i);
         }
         if(node->getOutgoingEdges(PAGEdge::Store).size() > O_BASE * 10){
-            blackNodes.insert(i);
+            blackNodes.set(i);
         }
         if(node->getOutgoingEdges(PAGEdge::Copy).size() > O_BASE * 15){
-            blackNodes.insert(i);
+            blackNodes.set(i);
         }
         if(node->getOutgoingEdges(PAGEdge::Load).size() > O_BASE * 5){
-            blackNodes.insert(i);
+            blackNodes.set(i);
         }
     }
 
     for(auto node : Call2Ret){
         if(node.second.size() > BASE_NUM){
-            blackNodes.insert(node.first);
+            blackNodes.set(node.first);
         }
     }
     for(auto node : Ret2Call){
         if(node.second.size() > BASE_NUM){
-            blackNodes.insert(node.first);
+            blackNodes.set(node.first);
         }
     }
     for(auto node : Formal2Real){
         if(node.second.size() > BASE_NUM){
-            blackNodes.insert(node.first);
+            blackNodes.set(node.first);
         }
     }
     for(auto node : Real2Formal){
         if(node.second.size() > BASE_NUM * 2.5){
-            blackNodes.insert(node.first);
+            blackNodes.set(node.first);
         }
     }
 
-    errs() << "blackNodes: " << blackNodes.size() << "\n";
+    initLog() << "blackNodes: " << blackNodes.count() << "\n";
+}
+
+// [initialize] 从文件读取分配函数名的子串黑名单，每行一个，忽略空行和#开头的注释，替换默认的列表。
+void loadAllocDenyList(string filename){
+    ifstream fin(filename);
+    if(!fin.is_open()){
+        errs() << "[initialize] Cannot open AllocDenyList " << filename << ", keep the default list.\n";
+        return;
+    }
+    allocDenyList.clear();
+    string line;
+    while(getline(fin, line)){
+        auto first = line.find_first_not_of(" \t\r");
+        if(first == string::npos || line[first] == '#'){
+            continue;
+        }
+        auto last = line.find_last_not_of(" \t\r");
+        allocDenyList.push_back(line.substr(first, last - first + 1));
+    }
+    fin.close();
+    errs() << "allocDenyList: " << allocDenyList.size() << "\n";
+}
+
+static bool ifAdmissibleCallee(const SVFFunction* callee, const unordered_set<string> &blackList,
+                               unordered_map<const SVFFunction*, bool> &memo){
+    // 拿不到callee时不做限制。
+    if(!callee){
+        return true;
+    }
+    auto it = memo.find(callee);
+    if(it != memo.end()){
+        return it->second;
+    }
+    const string &name = callee->getName();
+    bool admissible = blackList.find(name) == blackList.end();
+    for(auto &deny : allocDenyList){
+        if(!admissible){
+            break;
+        }
+        admissible = name.find(deny) == string::npos;
+    }
+    memo[callee] = admissible;
+    return admissible;
+}
+
+// [initialize] 为每条Call/Ret边算好能否进入，ComputeAlias不再查callee名。
+void setupCallAdmissibility(SVFIR* pag){
+    EdgeID bound = 0;
+    for(auto edge : pag->getSVFStmtSet(SVFStmt::Call)){
+        bound = std::max(bound, edge->getEdgeID() + 1);
+    }
+    for(auto edge : pag->getSVFStmtSet(SVFStmt::Ret)){
+        bound = std::max(bound, edge->getEdgeID() + 1);
+    }
+    blockedCallEdges.clear();
+    blockedCallEdges.resize(bound);
+
+    unordered_map<const SVFFunction*, bool> callMemo, retMemo;
+    for(auto edge : pag->getSVFStmtSet(SVFStmt::Call)){
+        const auto callee = SVFUtil::getCallee(SVFUtil::cast<CallPE>(edge)->getCallInst()->getCallSite());
+        if(!ifAdmissibleCallee(callee, blackCalls, callMemo)){
+            blockedCallEdges.set(edge->getEdgeID());
+        }
+    }
+    for(auto edge : pag->getSVFStmtSet(SVFStmt::Ret)){
+        const auto callee = SVFUtil::getCallee(SVFUtil::cast<RetPE>(edge)->getCallInst()->getCallSite());
+        if(!ifAdmissibleCallee(callee, blackRets, retMemo)){
+            blockedCallEdges.set(edge->getEdgeID());
+        }
+    }
+    initLog() << "blockedCallEdges: " << blockedCallEdges.count() << "\n";
 }
 
 // [initialize]
@@ -205,13 +367,13 @@ void setupPhiEdges(SVFIR* pag){
         const auto phi = dyn_cast<PhiStmt>(edge);
         const auto dst = edge->getDstNode();
         for(auto var : phi->getOpndVars()){
-            if(blackNodes.find(var->getId()) == blackNodes.end()){
+            if(!isBlackNode(var->getId())){
                 phiIn[dst->getId()][edge].insert(var->getId());
                 phiOut[var->getId()][edge].insert(dst->getId());
             }
         }
     }
-    errs() << "[initialize] Finish setupPhiEdges!\n";
+    initLog() << "[initialize] Finish setupPhiEdges!\n";
 }
 
 // [initialize]
@@ -224,7 +386,7 @@ void setupSelectEdges(SVFIR* pag){
         selectOut[select->getTrueValue()->getId()][edge].insert(dst->getId());
         selectOut[select->getFalseValue()->getId()][edge].insert(dst->getId());
     }
-    errs() << "[initialize] Finish setupSelectEdges!\n";
+    initLog() << "[initialize] Finish setupSelectEdges!\n";
 }
 
 // [tool] 以一种硬编码的方式计算Type的字节数大小，供很多其他工具函数调用。
@@ -295,6 +457,25 @@ string getStructName(StructType* sttype){
     return "";
 }
 
+// [tool] 把结构体类型映射为dense ID，第一次遇到时按getStructName的结果分配。
+// 只在初始化阶段（handleAnonymousStruct之后）调用，此后getStructName对同一类型的结果不再变化。
+StructID getStructID(StructType* sttype){
+    auto it = structType2ID.find(sttype);
+    if(it != structType2ID.end()){
+        return it->second;
+    }
+    if(structNames.empty()){
+        structNames.push_back("");
+        structName2ID[""] = EMPTY_STRUCT_ID;
+    }
+    auto res = structName2ID.emplace(getStructName(sttype), structNames.size());
+    if(res.second){
+        structNames.push_back(res.first->first);
+    }
+    structType2ID[sttype] = res.first->second;
+    return res.first->second;
+}
+
 unordered_set<CallInst*>* getSpecificGV(SVFModule* svfmod);
 
 unordered_set<PAGNode*> addrvisited;
@@ -337,9 +518,9 @@ bool checkIfAddrTaken(SVFIR* pag, PAGNode* node){
 
 // [initialize]
 void handleAnonymousStruct(SVFModule* svfModule, SVFIR* pag){
-    errs() << "[initialize] Exec handleAnonymousStruct...\n";
+    initLog() << "[initialize] Exec handleAnonymousStruct...\n";
     unordered_map<StructType*, unordered_set<SVFGlobalValue*>> AnonymousTypeGVs;
-    errs() << "SVFModule GV size: " << svfModule->getGlobalSet().size() << "\n";
+    initLog() << "SVFModule GV size: " << svfModule->getGlobalSet().size() << "\n";
     for(auto ii = svfModule->global_begin(), ie = svfModule->global_end(); ii != ie; ii++){
         auto gv = *ii;
         if(auto gvtype = ifPointToStruct(gv->getType())){
@@ -396,15 +577,36 @@ void handleAnonymousStruct(SVFModule* svfModule, SVFIR* pag){
         }
     }
     deAnonymous = true;
-    errs() << "[initialize] Finish handleAnonymousStruct!\n";
+    initLog() << "[initialize] Finish handleAnonymousStruct!\n";
 }
 
+// [initialize] 在handleAnonymousStruct之后，为每个PAG节点记录其类型所指向结构体的ID。
+void setupStructIDs(SVFIR* pag){
+    node2StructID.assign(nodeIDBound, INVALID_STRUCT_ID);
+    unordered_map<const SVFType*, StructID> svfType2ID; // 很多节点共享同一个SVFType，每个SVFType只查一次LLVMModuleSet的map。
+    for(auto it = pag->begin(), ie = pag->end(); it != ie; ++it){
+        auto svfType = it->second->getType();
+        if(!svfType){
+            continue;
+        }
+        auto found = svfType2ID.find(svfType);
+        if(found == svfType2ID.end()){
+            auto sttype = ifPointToStruct(svfType);
+            found = svfType2ID.emplace(svfType, sttype ? getStructID(sttype) : INVALID_STRUCT_ID).first;
+        }
+        node2StructID[it->first] = found->second;
+    }
+    initLog() << "[initialize] Finish setupStructIDs! Struct IDs: " << structNames.size() << "\n";
+}
+
+static raw_ostream &byteoffsetLog();
+
 // [tool] 用于collectByteoffset。
 // 
 long varStructVisit(GEPOperator* gepop, const DataLayout* DL){
     // errs() << "  [varStructVisit]\n";
     if(!DL) {
-        errs() << "varStructVisit: DataLayout is not available!\n";
+        byteoffsetLog() << "varStructVisit: DataLayout is not available!\n";
     }
     long ret = 0;
     bool first = true;
@@ -439,13 +641,71 @@ long varStructVisit(GEPOperator* gepop, const DataLayout* DL){
     return ret;
 }
 
+// collectByteoffset的分片输出：并行处理时，gepIn和regularStructVisit产生的shortcuts先记在线程自己的分片里，
+// 每条记录带上该边在串行顺序中的位置，合并时按位置回放。StructID也推迟到回放时再分配，
+// 因此全局表的内容、插入顺序以及新结构体的ID编号都与串行执行时完全一致。
+struct ByteoffsetShard {
+    struct GepInRecord {
+        size_t pos;
+        PAGNode* node;
+        PAGEdge* edge;
+    };
+    struct ShortcutRecord {
+        size_t pos;
+        StructType* sttype;
+        long offset;
+        PAGEdge* gep;
+    };
+    size_t pos = 0; // 当前处理的边的位置。
+    vector<GepInRecord> gepIns;
+    vector<ShortcutRecord> shortcuts;
+    string log;
+    raw_string_ostream logStream{log};
+};
+
+static thread_local ByteoffsetShard* curByteoffsetShard = nullptr; // 为空表示串行执行，直接写全局表。
+
+// collectByteoffset内部的日志：并行时先写到分片里，结束后统一输出。
+static raw_ostream &byteoffsetLog(){
+    if(curByteoffsetShard){
+        return curByteoffsetShard->logStream;
+    }
+    return initLog();
+}
+
+static void recordGepIn(PAGEdge* edge){
+    if(curByteoffsetShard){
+        curByteoffsetShard->gepIns.push_back({curByteoffsetShard->pos, edge->getDstNode(), edge});
+    }else{
+        gepIn[edge->getDstNode()] = edge;
+    }
+}
+
+static void addTypebasedShortcut(StructType* sttype, long offset, PAGEdge* gep){
+    const auto stID = getStructID(sttype);
+    if(stID != EMPTY_STRUCT_ID){
+        typebasedShortcuts[stID][offset].insert(gep);
+        reverseShortcuts[gep][offset].insert(stID);
+        // For edge struct.A.B.C, only allow B.C edge, and A.B.C edge to here,
+        // But for this edge, we don't know other B.C edges yet
+    }
+}
+
+static void recordTypebasedShortcut(StructType* sttype, long offset, PAGEdge* gep){
+    if(curByteoffsetShard){
+        curByteoffsetShard->shortcuts.push_back({curByteoffsetShard->pos, sttype, offset, gep});
+    }else{
+        addTypebasedShortcut(sttype, offset, gep);
+    }
+}
+
 // [tool] 用于collectByteoffset函数。
 // 根据给定GEP边的结构体类型和成员index，计算其byteOffset并返回。
 // 重点重构对象！
 long regularStructVisit(StructType* sttype, s64_t idx, PAGEdge* gep, const DataLayout* DL){
     // errs() << "  [regularStructVisit]\n";
     if(!DL) {
-        errs() << "regularStructVisit: DataLayout is not available!\n"; // Triggered.
+        byteoffsetLog() << "regularStructVisit: DataLayout is not available!\n"; // Triggered.
     }
     // errs() << "regularStructVisit: " << printVal(gep->getValue()) << "\n"; // For Debug.
     // ret byteoffset
@@ -484,13 +744,7 @@ long regularStructVisit(StructType* sttype, s64_t idx, PAGEdge* gep, const DataL
         }
     }
     // 记录全局变量并返回byteOffset值。
-    const auto stname = getStructName(sttype);
-    if(stname != ""){
-        typebasedShortcuts[stname][ret].insert(gep);
-        reverseShortcuts[gep][ret].insert(stname);
-        // For edge struct.A.B.C, only allow B.C edge, and A.B.C edge to here,
-        // But for this edge, we don't know other B.C edges yet
-    }
+    recordTypebasedShortcut(sttype, ret, gep);
     return ret;
 }
 
@@ -519,11 +773,11 @@ void setupStores(SVFIR* pag){
                 for(auto srcNode : srcNodes){
                     if(gepIn.find(srcNode) != gepIn.end() && reverseShortcuts.find(gepIn[srcNode]) != reverseShortcuts.end()){
                         for(auto srcIdx : reverseShortcuts[gepIn[srcNode]]){
-                            for(auto srcName : srcIdx.second){
+                            for(auto srcID : srcIdx.second){
                                 for(auto dstIdx : reverseShortcuts[gepIn[dstNode]]){
-                                    for(auto dstName : dstIdx.second){
-                                        if(srcName != dstName){
-                                            additionalShortcuts[dstName][dstIdx.first].insert(&typebasedShortcuts[srcName][srcIdx.first]);
+                                    for(auto dstID : dstIdx.second){
+                                        if(srcID != dstID){
+                                            additionalShortcuts[dstID][dstIdx.first].insert(&typebasedShortcuts[srcID][srcIdx.first]);
                                         }
                                     }
                                 }
@@ -534,10 +788,10 @@ void setupStores(SVFIR* pag){
             }
         }
     }
-    errs() << "additional shortcuts: " << additionalShortcuts.size() << "\n";
+    initLog() << "additional shortcuts: " << additionalShortcuts.size() << "\n";
     reverseShortcuts.clear();
     gepIn.clear();
-    errs() << "[initialize] Finish setupStores!\n";
+    initLog() << "[initialize] Finish setupStores!\n";
 }
 
 // [tool] 用于collectByteoffset。
@@ -546,6 +800,11 @@ StructType* gotStructSrc(PAGNode* node, unordered_set<PAGNode*> &visitedNodes){
     if(!visitedNodes.insert(node).second){
         return nullptr;
     }
+    // 先用只读的hasIncomingEdges判断：getIncomingEdges在没有该类边时会往节点的map里插入空集合，collectByteoffset并行时不能这样写。
+    if(!node->hasIncomingEdges(PAGEdge::Copy)){
+        visitedNodes.erase(node);
+        return nullptr;
+    }
     for(auto nxt : node->getIncomingEdges(PAGEdge::Copy)){
         if(auto nxtType = nxt->getSrcNode()->getType()){
             auto llvmNxtTyoe = LLVMModuleSet::getLLVMModuleSet()->getLLVMType(nxtType);
@@ -571,19 +830,233 @@ void debugGEP(const PAGEdge* edge) {
     errs() << "GEP SrcNode: " << printVal(edge->getSrcNode()->getValue()) << "\n";
     errs() << "GEP DstNode: " << printVal(edge->getDstNode()->getValue()) << "\n";
     errs() << "    ";
-    if(gep2byteoffset.find(edge) != gep2byteoffset.end()) {
-        errs() << "[GEP, byteOffset: " << gep2byteoffset[edge] << "]";
-    }
-    if(variantGep.find(edge) != variantGep.end()) {
-        errs() << "[Variant GEP]";
+    if(auto info = getGepInfo(edge)) {
+        if(info->flags & GEP_HAS_OFFSET) {
+            errs() << "[GEP, byteOffset: " << info->offset << "]";
+        }
+        if(info->flags & GEP_VARIANT) {
+            errs() << "[Variant GEP]";
+        }
     }
     errs() << "\n";
 }
 
-// [initialize] 负责gep2byteoffset和variantGep的初始化。 
+static void setGepOffset(const PAGEdge* edge, long offset) {
+    auto &info = gepInfos[edge->getEdgeID()];
+    info.offset = offset;
+    info.flags |= GEP_HAS_OFFSET;
+}
+
+static void setGepVariant(const PAGEdge* edge) {
+    gepInfos[edge->getEdgeID()].flags |= GEP_VARIANT;
+}
+
+struct GepTask {
+    PAGEdge* edge;
+    const GepStmt* gepstmt;
+    const Value* llvmValue;
+    const DataLayout* DL;
+};
+
+// 处理一条GEP边：计算byteOffset或标记为variant。DL为该边所在module的DataLayout。
+static void collectEdgeByteoffset(PAGEdge* edge, const GepStmt* gepstmt, const Value* llvmValue, const DataLayout* DL){
+    recordGepIn(edge);
+    
+    // auto svfGepInst = edge->getInst();
+    // if(!svfGepInst) {
+    //     byteoffsetLog() << "[collectByteoffset] Can't get svfGepInst!\n"; // reachable. 说明GepStmt相应的SVFValue也许不是一个SVFInstruction。
+    //     return;
+    // }
+    // byteoffsetLog() << "  svfGepInst: " << svfGepInst->toString() << "\n";
+
+    // const auto gepInst = dyn_cast<GetElementPtrInst>(llvmValue); // 这样获取gepInst极有可能得到nullptr。
+    // byteoffsetLog() << "  gepInst: "; gepInst->print(errs()); errs()<<"\n"; // Problem: 空!
+
+    // 处理getelementptr指令被嵌在call指令中的情况：需要借助gotStructSrc去推断base的类型。因为mem函数传参时常常会有类型转换。
+    if(auto callInst = dyn_cast<CallInst>(llvmValue)){
+        byteoffsetLog() << "  Enter branch (getelementptr in callInst).\n";
+        // memset, memcpy, llvm.memmove.p0i8.p0i8.i64, llvm.memset.p0i8.i64, llvm.memcpy.p0i8.p0i8.i64
+        // 函数名不包含memset才能进入if body。
+        if(callInst->getCalledFunction()->getName().find("memset") == string::npos){
+            unordered_set<PAGNode*> visitedNodes; // 仅用于getSrcNodes函数。
+            if(auto sttype = gotStructSrc(edge->getSrcNode(), visitedNodes)){ // 通过Copy边去尝试推断结构体类型。
+                // 常规的结构体成员访问。
+                setGepOffset(edge, regularStructVisit(sttype, gepstmt->getConstantStructFldIdx(), edge, DL));
+                // debugGEP(edge);
+            }else{
+                if(!gepstmt->isVariantFieldGep() && gepstmt->isConstantOffset() && edge->getSrcNode()->getOutgoingEdges(PAGEdge::Gep).size() < 20){
+                    // 非结构体的偏移访问（通常类型为i8，直接把index作为byteOffset）。
+                    setGepOffset(edge, gepstmt->getConstantStructFldIdx());
+                    // debugGEP(edge);
+                }else{
+                    // non-constant的成员访问。
+                    setGepVariant(edge);
+                    // debugGEP(edge);
+                }
+            }
+        }
+        return;
+    }
+
+    // 处理正常的、单独的getelementptr操作。
+    auto svfType = edge->getSrcNode()->getType();
+    if(!svfType){
+        byteoffsetLog() << "[collectByteoffset] Can't get svvfType for GepStmt SrcNode!\n"; // Triggered.
+        return;
+    }
+    auto llvmType = getLLVMType(svfType);
+    if(!llvmType){
+        byteoffsetLog() << "[collectByteoffset] Can't get llvmType for GepStmt SrcNode!\n"; // Triggered.
+        return;
+    }
+    // 要求Field边的Src节点是结构体指针类型。根据base的type和GEP的index计算byteOffset。
+    if(llvmType->isPointerTy() && llvmType->getNumContainedTypes() > 0){
+        auto elemType = llvmType->getPointerElementType();
+        while(elemType && elemType->isArrayTy()){
+            elemType = elemType->getArrayElementType();
+        }
+        // elemType是从GEP边SrcNode拿到的结构体/数组的基础类型，然后根据idx计算byteOffset。
+        if(elemType){
+            // 处理non-constant的成员访问。
+            if(!gepstmt->isConstantOffset()){
+                // contains non-const index
+                if(elemType->isSingleValueType()){
+                    // gep i8*, i64 0, %var
+                    // 这种情况下，处理的是标量数组索引的Gep边。索引值为variant。
+                    setGepVariant(edge);
+                    // debugGEP(edge);
+                }else if(elemType->isStructTy()){
+                    if(gepstmt->isVariantFieldGep()){
+                        // gep struct.A*, %var
+                        // 这种情况下，处理的是结构体数组索引的Gep边。索引值为variant。
+                        setGepOffset(edge, 0);
+                        // debugGEP(edge);
+                    }else{
+                        // getelementptr %struct.acpi_pnp_device_id_list, %struct.acpi_pnp_device_id_list* %8, i64 0, i32 2, i64 %indvars.iv, i32 1
+                        // 这种情况下，处理的是结构体成员访问的Gep边。某个子索引值为variant。
+                        setGepOffset(edge, varStructVisit(const_cast<GEPOperator*>(dyn_cast<GEPOperator>(getLLVMValue(edge->getValue()))), DL));
+                        // debugGEP(edge);
+                    }
+                }else{
+                    assert(false && "no ther case 1");
+                }
+            }
+            // 处理常量index的成员访问。
+            else{
+                if(elemType->isSingleValueType()){
+                    // 这种情况下，edge->getSrcNode()的类型是标量数组（可能是多维数组）。
+                    // gep2byteoffset[edge] = DL->getTypeStoreSize(type->getPointerElementType()) * gepstmt->accumulateConstantOffset();
+                    // 此处代码是错的：第一个乘数应该取elemType；第二个乘数试了几个case都是0。
+                    // gep2byteoffset[edge] = getManualTypeSize(type->getPointerElementType()) * gepstmt->accumulateConstantOffset(); 
+                    // 个人感觉这里也不能用SVF的GepStmt做分析，还是应该直接拿到GetElementPtrInst进行分析。
+                    // gep2byteoffset[edge] = getTypeSize(DL, elemType) * gepstmt->getConstantFieldIdx();
+                    // Anyways保守点就直接记录为0。相当于回退到array-insensitive，只访问数组第一个元素。
+                    const auto gepInst = dyn_cast<GetElementPtrInst>(llvmValue);
+                    if(!gepInst) {
+                        byteoffsetLog() << "[collectByteoffset] Can't get gepInst from llvmValue!\n"; // Triggered many times.
+                        return;
+                    }
+                    if(gepInst) {
+                        if(gepInst->getNumIndices()==1) { 
+                            // 处理指针变量的加减法（可看作raw方式的数组索引）。
+                            setGepOffset(edge, getTypeSize(DL, elemType) * getGepIndexValue(gepInst, 0));
+                        } else if(gepInst->getNumIndices()==2) {
+                            // 处理普通的一维数组。
+                            setGepOffset(edge, getTypeSize(DL, elemType) * getGepIndexValue(gepInst, 1));
+                        }
+                        else if(gepInst->getNumIndices() > 2) {
+                            // TODO: 处理多维数组。
+                            setGepOffset(edge, 0);
+                        } else {
+                            setGepOffset(edge, 0);
+                        }
+                        // debugGEP(edge);
+                    }
+                    // byteoffsetLog() << "\nArray???: " << gep2byteoffset[edge] << "\t" << printVal(edge->getValue()) << "\n";
+                    // gepstmt->getLocationSet().dump(); byteoffsetLog() << "; " << getTypeSize(DL, elemType) << "\t" << gepstmt->getConstantFieldIdx() << "\n";
+                }else if (elemType->isStructTy()){
+                    // 这种情况下，edge->getSrcNode()的类型是结构体或结构体数组。
+                    StructType* stType = dyn_cast<StructType>(elemType);
+                    s64_t idx = gepstmt->getConstantStructFldIdx();
+                    setGepOffset(edge, regularStructVisit(stType, idx, edge, DL));
+                    // debugGEP(edge);
+                }else{
+                    assert(false && "no other case 2"); // Unias分析kernel不会走到这里。
+                }
+            }
+        }
+    }else{
+        // 跑实验证明其实不太会跑到这个分支。
+        byteoffsetLog() << printVal(edge->getValue()) << "\n";
+    }
+}
+
+// 按module分片并行执行collectEdgeByteoffset。同一个module（同一个DataLayout，其StructLayout缓存不是线程安全的）
+// 只会被一个线程处理；gepInfos按EdgeID下标写，各边互不重叠；其余全局表只在合并时由本线程写。
+static void collectByteoffsetSharded(const vector<GepTask> &tasks, u32_t threadNum){
+    vector<vector<size_t>> buckets;
+    unordered_map<const DataLayout*, size_t> bucketIdx;
+    for(size_t i = 0; i < tasks.size(); i++){
+        auto res = bucketIdx.emplace(tasks[i].DL, buckets.size());
+        if(res.second){
+            buckets.emplace_back();
+        }
+        buckets[res.first->second].push_back(i);
+    }
+    // 大的module先处理，减少尾部等待。
+    std::stable_sort(buckets.begin(), buckets.end(), [](const vector<size_t> &a, const vector<size_t> &b){ return a.size() > b.size(); });
+
+    threadNum = std::max<u32_t>(1, std::min<size_t>(threadNum, buckets.size()));
+    vector<ByteoffsetShard> shards(threadNum);
+    std::atomic<size_t> next(0);
+    vector<std::thread> threads;
+    for(u32_t t = 0; t < threadNum; t++){
+        threads.emplace_back([&, t](){
+            curByteoffsetShard = &shards[t];
+            for(size_t b = next++; b < buckets.size(); b = next++){
+                for(auto i : buckets[b]){
+                    shards[t].pos = i;
+                    collectEdgeByteoffset(tasks[i].edge, tasks[i].gepstmt, tasks[i].llvmValue, tasks[i].DL);
+                }
+            }
+            curByteoffsetShard = nullptr;
+        });
+    }
+    for(auto &thread : threads){
+        thread.join();
+    }
+
+    vector<ByteoffsetShard::GepInRecord> gepIns;
+    vector<ByteoffsetShard::ShortcutRecord> shortcuts;
+    for(auto &shard : shards){
+        initLog() << shard.logStream.str();
+        gepIns.insert(gepIns.end(), shard.gepIns.begin(), shard.gepIns.end());
+        shortcuts.insert(shortcuts.end(), shard.shortcuts.begin(), shard.shortcuts.end());
+    }
+    // 同一条边的记录都在同一个分片里且保持原有先后，稳定排序后即为串行顺序。
+    std::stable_sort(gepIns.begin(), gepIns.end(), [](const ByteoffsetShard::GepInRecord &a, const ByteoffsetShard::GepInRecord &b){ return a.pos < b.pos; });
+    std::stable_sort(shortcuts.begin(), shortcuts.end(), [](const ByteoffsetShard::ShortcutRecord &a, const ByteoffsetShard::ShortcutRecord &b){ return a.pos < b.pos; });
+    for(auto &rec : gepIns){
+        gepIn[rec.node] = rec.edge;
+    }
+    for(auto &rec : shortcuts){
+        addTypebasedShortcut(rec.sttype, rec.offset, rec.gep);
+    }
+    initLog() << "[collectByteoffset] " << tasks.size() << " GEPs in " << buckets.size() << " modules on " << threadNum << " threads\n";
+}
+
+// [initialize] 负责gepInfos中offset和variant标记的初始化。 
 // 实现field-sensitive的非常重要的函数，里面还调用了一些复杂的工具函数。（非递归函数）
 // 结构体嵌套以及多级index的gep指令是怎么处理的？一般就两个"type+idx"，然后多个gep指令来构成多级索引。
-void collectByteoffset(SVFIR* pag){
+// threadNum>1时按module分片并行处理，结果与串行一致。
+void collectByteoffset(SVFIR* pag, u32_t threadNum){
+    EdgeID bound = 0;
+    for(auto const edge : pag->getSVFStmtSet(PAGEdge::Gep)){
+        bound = std::max(bound, edge->getEdgeID() + 1);
+    }
+    gepInfos.assign(bound, GepInfo{0, INVALID_STRUCT_ID, 0});
+    // 第一遍（串行）：取出每条GEP边的LLVM Value和所在module。value2Module等缓存只在这一遍里写。
+    vector<GepTask> tasks;
     // 遍历PAG中的所有GEP边。将其转化为对应的LLVMInstruction并进行相关处理。
     // errs() << "[collectByteoffset] GEP Edges size: " << pag->getSVFStmtSet(PAGEdge::Gep).size() << "\n";
     for(auto const edge : pag->getSVFStmtSet(PAGEdge::Gep)){
@@ -591,14 +1064,14 @@ void collectByteoffset(SVFIR* pag){
         // 此处PAGEdge edge其实都应该是GepStmt类型。
         const auto gepstmt = dyn_cast<GepStmt>(edge);
         if(!gepstmt){
-            errs() << "[collectByteoffset] Can't get gepstmt!\n"; // not reached.
+            initLog() << "[collectByteoffset] Can't get gepstmt!\n"; // not reached.
             continue;
         }
         // errs()<<"  gepstmt: "<<gepstmt->toString()<<"\n";
         // 理解：edge是SVFStatement，其配套了一个SVFValue。我们希望由此得到LLVM Instruction。
         auto llvmValue = getLLVMValue(edge->getValue());
         if(!llvmValue) {
-            errs() << "[collectByteoffset] Can't get llvmValue for GepStmt!\n"; // not reached.
+            initLog() << "[collectByteoffset] Can't get llvmValue for GepStmt!\n"; // not reached.
             continue;
         }
         // errs()<<"  llvmValue: "; llvmValue->print(errs()); errs()<<"\n";
@@ -610,150 +1083,32 @@ void collectByteoffset(SVFIR* pag){
             DL = &mod->getDataLayout();
         } else {
             DL = nullptr;
-            errs() << "[collectByteoffset] Fail to getModuleFromValue: "<< printVal(edge->getValue()) <<"\n"; // Triggered.
+            initLog() << "[collectByteoffset] Fail to getModuleFromValue: "<< printVal(edge->getValue()) <<"\n"; // Triggered.
             continue;
             // 这主要会影响：regularStructVisit、varStructVisit、标量数组的处理。本质上还是影响了getTypeSize函数。
         }
-        gepIn[edge->getDstNode()] = edge;
-        
-        // auto svfGepInst = edge->getInst();
-        // if(!svfGepInst) {
-        //     errs() << "[collectByteoffset] Can't get svfGepInst!\n"; // reachable. 说明GepStmt相应的SVFValue也许不是一个SVFInstruction。
-        //     continue;
-        // }
-        // errs() << "  svfGepInst: " << svfGepInst->toString() << "\n";
-
-        // const auto gepInst = dyn_cast<GetElementPtrInst>(llvmValue); // 这样获取gepInst极有可能得到nullptr。
-        // errs() << "  gepInst: "; gepInst->print(errs()); errs()<<"\n"; // Problem: 空!
-
-        // 处理getelementptr指令被嵌在call指令中的情况：需要借助gotStructSrc去推断base的类型。因为mem函数传参时常常会有类型转换。
-        if(auto callInst = dyn_cast<CallInst>(llvmValue)){
-            errs() << "  Enter branch (getelementptr in callInst).\n";
-            // memset, memcpy, llvm.memmove.p0i8.p0i8.i64, llvm.memset.p0i8.i64, llvm.memcpy.p0i8.p0i8.i64
-            // 函数名不包含memset才能进入if body。
-            if(callInst->getCalledFunction()->getName().find("memset") == string::npos){
-                unordered_set<PAGNode*> visitedNodes; // 仅用于getSrcNodes函数。
-                if(auto sttype = gotStructSrc(edge->getSrcNode(), visitedNodes)){ // 通过Copy边去尝试推断结构体类型。
-                    // 常规的结构体成员访问。
-                    gep2byteoffset[edge] = regularStructVisit(sttype, gepstmt->getConstantStructFldIdx(), edge, DL);
-                    // debugGEP(edge);
-                }else{
-                    if(!gepstmt->isVariantFieldGep() && gepstmt->isConstantOffset() && edge->getSrcNode()->getOutgoingEdges(PAGEdge::Gep).size() < 20){
-                        // 非结构体的偏移访问（通常类型为i8，直接把index作为byteOffset）。
-                        gep2byteoffset[edge] = gepstmt->getConstantStructFldIdx();
-                        // debugGEP(edge);
-                    }else{
-                        // non-constant的成员访问。
-                        variantGep.insert(edge);
-                        // debugGEP(edge);
-                    }
-                }
-            }
-            continue;
-        }
+        tasks.push_back(GepTask{edge, gepstmt, llvmValue, DL});
+    }
 
-        // 处理正常的、单独的getelementptr操作。
-        auto svfType = edge->getSrcNode()->getType();
-        if(!svfType){
-            errs() << "[collectByteoffset] Can't get svvfType for GepStmt SrcNode!\n"; // Triggered.
-            continue;
-        }
-        auto llvmType = getLLVMType(svfType);
-        if(!llvmType){
-            errs() << "[collectByteoffset] Can't get llvmType for GepStmt SrcNode!\n"; // Triggered.
-            continue;
-        }
-        // 要求Field边的Src节点是结构体指针类型。根据base的type和GEP的index计算byteOffset。
-        if(llvmType->isPointerTy() && llvmType->getNumContainedTypes() > 0){
-            auto elemType = llvmType->getPointerElementType();
-            while(elemType && elemType->isArrayTy()){
-                elemType = elemType->getArrayElementType();
-            }
-            // elemType是从GEP边SrcNode拿到的结构体/数组的基础类型，然后根据idx计算byteOffset。
-            if(elemType){
-                // 处理non-constant的成员访问。
-                if(!gepstmt->isConstantOffset()){
-                    // contains non-const index
-                    if(elemType->isSingleValueType()){
-                        // gep i8*, i64 0, %var
-                        // 这种情况下，处理的是标量数组索引的Gep边。索引值为variant。
-                        variantGep.insert(edge);
-                        // debugGEP(edge);
-                    }else if(elemType->isStructTy()){
-                        if(gepstmt->isVariantFieldGep()){
-                            // gep struct.A*, %var
-                            // 这种情况下，处理的是结构体数组索引的Gep边。索引值为variant。
-                            gep2byteoffset[edge] = 0;
-                            // debugGEP(edge);
-                        }else{
-                            // getelementptr %struct.acpi_pnp_device_id_list, %struct.acpi_pnp_device_id_list* %8, i64 0, i32 2, i64 %indvars.iv, i32 1
-                            // 这种情况下，处理的是结构体成员访问的Gep边。某个子索引值为variant。
-                            gep2byteoffset[edge] = varStructVisit(const_cast<GEPOperator*>(dyn_cast<GEPOperator>(getLLVMValue(edge->getValue()))), DL);
-                            // debugGEP(edge);
-                        }
-                    }else{
-                        assert(false && "no ther case 1");
-                    }
-                }
-                // 处理常量index的成员访问。
-                else{
-                    if(elemType->isSingleValueType()){
-                        // 这种情况下，edge->getSrcNode()的类型是标量数组（可能是多维数组）。
-                        // gep2byteoffset[edge] = DL->getTypeStoreSize(type->getPointerElementType()) * gepstmt->accumulateConstantOffset();
-                        // 此处代码是错的：第一个乘数应该取elemType；第二个乘数试了几个case都是0。
-                        // gep2byteoffset[edge] = getManualTypeSize(type->getPointerElementType()) * gepstmt->accumulateConstantOffset(); 
-                        // 个人感觉这里也不能用SVF的GepStmt做分析，还是应该直接拿到GetElementPtrInst进行分析。
-                        // gep2byteoffset[edge] = getTypeSize(DL, elemType) * gepstmt->getConstantFieldIdx();
-                        // Anyways保守点就直接记录为0。相当于回退到array-insensitive，只访问数组第一个元素。
-                        const auto gepInst = dyn_cast<GetElementPtrInst>(llvmValue);
-                        if(!gepInst) {
-                            errs() << "[collectByteoffset] Can't get gepInst from llvmValue!\n"; // Triggered many times.
-                            continue;
-                        }
-                        if(gepInst) {
-                            if(gepInst->getNumIndices()==1) { 
-                                // 处理指针变量的加减法（可看作raw方式的数组索引）。
-                                gep2byteoffset[edge] = getTypeSize(DL, elemType) * getGepIndexValue(gepInst, 0);
-                            } else if(gepInst->getNumIndices()==2) {
-                                // 处理普通的一维数组。
-                                gep2byteoffset[edge] = getTypeSize(DL, elemType) * getGepIndexValue(gepInst, 1);
-                            }
-                            else if(gepInst->getNumIndices() > 2) {
-                                // TODO: 处理多维数组。
-                                gep2byteoffset[edge] = 0;
-                            } else {
-                                gep2byteoffset[edge] = 0;
-                            }
-                            // debugGEP(edge);
-                        }
-                        // errs() << "\nArray???: " << gep2byteoffset[edge] << "\t" << printVal(edge->getValue()) << "\n";
-                        // gepstmt->getLocationSet().dump(); errs() << "; " << getTypeSize(DL, elemType) << "\t" << gepstmt->getConstantFieldIdx() << "\n";
-                    }else if (elemType->isStructTy()){
-                        // 这种情况下，edge->getSrcNode()的类型是结构体或结构体数组。
-                        StructType* stType = dyn_cast<StructType>(elemType);
-                        s64_t idx = gepstmt->getConstantStructFldIdx();
-                        gep2byteoffset[edge] = regularStructVisit(stType, idx, edge, DL);
-                        // debugGEP(edge);
-                    }else{
-                        assert(false && "no other case 2"); // Unias分析kernel不会走到这里。
-                    }
-                }
-            }
-        }else{
-            // 跑实验证明其实不太会跑到这个分支。
-            errs() << printVal(edge->getValue()) << "\n";
+    if(threadNum <= 1){
+        for(auto &task : tasks){
+            collectEdgeByteoffset(task.edge, task.gepstmt, task.llvmValue, task.DL);
         }
+    }else{
+        collectByteoffsetSharded(tasks, threadNum);
+    }
+    initLog() << "[initialize] Finish collectByteoffset!\n";
+    u64_t offsetNum = 0, variantNum = 0;
+    for(auto &info : gepInfos){
+        offsetNum += (info.flags & GEP_HAS_OFFSET) != 0;
+        variantNum += (info.flags & GEP_VARIANT) != 0;
     }
-    errs() << "[initialize] Finish collectByteoffset!\n";
-    errs() << "gep2byteoffset Num: " << gep2byteoffset.size() << "\n";  // 1037227
-    errs() << "variantGep Num: " << variantGep.size() << "\n";  // 33988
+    initLog() << "gepOffset Num: " << offsetNum << "\n";  // 1037227
+    initLog() << "variantGep Num: " << variantNum << "\n";  // 33988
+    initLog() << "gepInfos memory: " << gepInfos.capacity() * sizeof(GepInfo) / 1024 / 1024 << "MB\n";
 
     // For debug. 只要Field-sensitivity或offset出问题，就从这里调试。验证每条GEP边的byteOffset是否正确。
-    // for (const auto &entry : gep2byteoffset) {
-    //     const PAGEdge *edge = entry.first;
-    //     debugGEP(edge);
-    // }
-    // for (const auto &edge : variantGep) {
+    // for (auto const edge : pag->getSVFStmtSet(PAGEdge::Gep)) {
     //     debugGEP(edge);
     // }
 }
@@ -762,19 +1117,50 @@ void collectByteoffset(SVFIR* pag){
 void processCastSites(SVFIR* pag){
     for(auto edge : pag->getSVFStmtSet(SVFStmt::Copy)){
         if(edge->getSrcNode()->getType() != edge->getDstNode()->getType()){
-            if(edge->getSrcNode()->getType()){
-                if(auto sttype = ifPointToStruct(edge->getSrcNode()->getType())){
-                    castSites[getStructName(sttype)].insert(edge);
-                }
+            const auto srcID = getNodeStructID(edge->getSrcNode()->getId());
+            if(srcID != INVALID_STRUCT_ID){
+                castSites[srcID].insert(edge);
+            }
+            const auto dstID = getNodeStructID(edge->getDstNode()->getId());
+            if(dstID != INVALID_STRUCT_ID){
+                castSites[dstID].insert(edge);
+            }
+        }
+    }
+    initLog() << "[initialize] Finish processCastSites!\n";
+}
+
+// [initialize] 在typebasedShortcuts和castSites都建好之后，为每条GEP边补上源结构体ID和两类shortcut的资格位。
+// 此后这两张表不能再修改，否则资格位会过时。
+void finalizeGepInfos(SVFIR* pag){
+    u64_t typebasedNum = 0, castSiteNum = 0;
+    for(auto const edge : pag->getSVFStmtSet(PAGEdge::Gep)){
+        const EdgeID id = edge->getEdgeID();
+        if(id >= gepInfos.size()){
+            continue;
+        }
+        auto &info = gepInfos[id];
+        info.stID = getNodeStructID(edge->getSrcNode()->getId());
+        info.flags &= ~(GEP_TYPEBASED_SC | GEP_CASTSITE_SC);
+        if(info.stID == INVALID_STRUCT_ID || !(info.flags & GEP_HAS_OFFSET)){
+            continue;
+        }
+        auto stIt = typebasedShortcuts.find(info.stID);
+        if(stIt != typebasedShortcuts.end()){
+            auto offsetIt = stIt->second.find(info.offset);
+            if(offsetIt != stIt->second.end() && offsetIt->second.size() < SC_THRESHOLD * 5){
+                info.flags |= GEP_TYPEBASED_SC;
+                typebasedNum++;
             }
-            if(edge->getDstNode()->getType()){
-                if(auto sttype = ifPointToStruct(edge->getDstNode()->getType())){
-                    castSites[getStructName(sttype)].insert(edge);
-                }
-            }   
+        }
+        auto castIt = castSites.find(info.stID);
+        if(castIt == castSites.end() || castIt->second.size() < SC_THRESHOLD){
+            info.flags |= GEP_CASTSITE_SC;
+            castSiteNum++;
         }
     }
-    errs() << "[initialize] Finish processCastSites!\n";
+    initLog() << "[initialize] Finish finalizeGepInfos! typebased shortcut GEPs " << typebasedNum
+           << ", castsite shortcut GEPs " << castSiteNum << "\n";
 }
 
 // [initialize]
@@ -876,7 +1262,7 @@ void processCastMap(SVFIR* pag){
             }
         }
     }
-    errs() << "[initialize] Finish processCastMap!\n";
+    initLog() << "[initialize] Finish processCastMap!\n";
 }
     
 
@@ -955,22 +1341,111 @@ void processArguments(int argc, char **argv, int &arg_num, char **arg_value,
     }
 }
 
+// 只在内核初始化/退出阶段执行的函数。
+bool isInitFunction(const Function* func){
+    return func->getSection().str() == ".init.text"
+        || func->getSection().str() == ".exit.text"
+        || NewInitFuncstr.find(func->getName().str()) != NewInitFuncstr.end();
+}
+
+// Store边所在的函数，没有时返回nullptr。
+const Function* getStoreFunction(const PAGEdge* store){
+    if(auto inst = dyn_cast_or_null<Instruction>(getLLVMValue(store->getValue()))){
+        return inst->getFunction();
+    }
+    return nullptr;
+}
+
+BitVector nonInitStoreNodes;
+bool nonInitStoreReady = false;
+
 // 判断一个变量节点是否可保护，即在init外有读写。
 bool checkIfProtectable(PAGNode* pagnode){
+    if(nonInitStoreReady){
+        const NodeID id = pagnode->getId();
+        return !(id < nonInitStoreNodes.size() && nonInitStoreNodes.test(id));
+    }
+    if(!pagnode->hasIncomingEdges(PAGEdge::Store)){
+        return true;
+    }
     for(auto edge : pagnode->getIncomingEdges(PAGEdge::Store)){
-        if(auto inst = dyn_cast<Instruction>(getLLVMValue(edge->getValue()))){
-            if(auto func = inst->getFunction()){
-                if(func->getSection().str() != ".init.text"
-                 && func->getSection().str() != ".exit.text"
-                 && NewInitFuncstr.find(func->getName().str()) == NewInitFuncstr.end()){
-                    return false;
-                }
+        if(auto func = getStoreFunction(edge)){
+            if(!isInitFunction(func)){
+                return false;
             }
         }
     }
     return true;
 }
 
+// 把[0, n)分成定长的块，threadNum个线程（含当前线程）轮流领取。
+template <typename F>
+static void parallelChunks(size_t n, u32_t threadNum, F body){
+    const size_t chunk = 4096;
+    threadNum = std::max<u32_t>(1, std::min<size_t>(threadNum, (n + chunk - 1) / chunk));
+    std::atomic<size_t> next(0);
+    auto work = [&](){
+        for(size_t begin; (begin = next.fetch_add(chunk)) < n;){
+            for(size_t i = begin; i < std::min(n, begin + chunk); i++){
+                body(i);
+            }
+        }
+    };
+    vector<std::thread> threads;
+    for(u32_t t = 1; t < threadNum; t++){
+        threads.emplace_back(work);
+    }
+    work();
+    for(auto &thread : threads){
+        thread.join();
+    }
+}
+
+// [initialize] 在getNewInitFuncs之后预计算checkIfProtectable的结果。
+// 先并行求出每条Store边所在的函数，再并行判断其中每个函数是否为init函数（section名和NewInitFuncstr的字符串比较每个函数只做一次），
+// 最后把不在init函数里的Store边的dst节点置位。之后checkIfProtectable只查nonInitStoreNodes。
+void setupProtectability(SVFIR* pag, u32_t threadNum){
+    auto start = std::chrono::steady_clock::now();
+    vector<const PAGEdge*> stores;
+    for(auto const edge : pag->getSVFStmtSet(PAGEdge::Store)){
+        stores.push_back(edge);
+    }
+    vector<const Function*> storeFuncs(stores.size(), nullptr);
+    parallelChunks(stores.size(), threadNum, [&](size_t i){
+        storeFuncs[i] = getStoreFunction(stores[i]);
+    });
+
+    vector<const Function*> funcs;
+    for(auto func : storeFuncs){
+        if(func){
+            funcs.push_back(func);
+        }
+    }
+    std::sort(funcs.begin(), funcs.end());
+    funcs.erase(std::unique(funcs.begin(), funcs.end()), funcs.end());
+    vector<u8_t> initFuncs(funcs.size(), 0);
+    parallelChunks(funcs.size(), threadNum, [&](size_t i){
+        initFuncs[i] = isInitFunction(funcs[i]);
+    });
+
+    nonInitStoreNodes.clear();
+    nonInitStoreNodes.resize(nodeIDBound);
+    for(size_t i = 0; i < stores.size(); i++){
+        if(!storeFuncs[i]){
+            continue;
+        }
+        const size_t f = std::lower_bound(funcs.begin(), funcs.end(), storeFuncs[i]) - funcs.begin();
+        if(!initFuncs[f]){
+            nonInitStoreNodes.set(stores[i]->getDstID());
+        }
+    }
+    nonInitStoreReady = true;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    errs() << "[setupProtectability] " << stores.size() << " stores in " << funcs.size() << " functions ("
+           << std::count(initFuncs.begin(), initFuncs.end(), 1) << " init), " << nonInitStoreNodes.count()
+           << " nodes with non-init stores, " << ms << "ms on " << threadNum << " threads\n";
+}
+
 bool pairCompare(const std::pair<s64_t, std::string>& a, const std::pair<s64_t, std::string>& b) {
     if (a.first == b.first) {
         return a.second < b.second;  // 如果值相同，"A" 小于 "B"
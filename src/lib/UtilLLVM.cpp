@@ -66,6 +66,23 @@ const llvm::CallInst *getLLVMCallInst(const SVFCallInst *inst) {
     return llvmInst;
 }
 
+const llvm::GlobalValue* getNodeOwner(const PAGNode* node) {
+    if (!node || !node->hasValue()) {
+        return nullptr;
+    }
+    const Value* val = getLLVMValue(node->getValue());
+    if (!val) {
+        return nullptr;
+    } else if (auto global = dyn_cast<GlobalValue>(val)) {
+        return global;
+    } else if (auto inst = dyn_cast<Instruction>(val)) {
+        return inst->getFunction();
+    } else if (auto arg = dyn_cast<Argument>(val)) {
+        return arg->getParent();
+    }
+    return nullptr;
+}
+
 
 // 
 // Raw LLVM IR analysis.